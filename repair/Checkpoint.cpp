@@ -0,0 +1,275 @@
+/*
+  This file is part of f1x.
+  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+
+  f1x is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sstream>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/log/trivial.hpp>
+
+#include "Checkpoint.h"
+#include "Util.h"
+
+namespace fs = boost::filesystem;
+
+using std::string;
+using std::vector;
+
+const string CHECKPOINT_HEADER = "f1x-checkpoint 1";
+
+
+//NOTE: statistics are saved in this order
+static vector<unsigned long*> statisticsFields(SearchStatistics &stat) {
+  return { &stat.explorationCounter,
+           &stat.executionCounter,
+           &stat.timeoutCounter,
+           &stat.nonTimeoutCounter,
+           &stat.nonTimeoutTestTime,
+           &stat.adaptiveTimeoutCounter,
+           &stat.savedTestTime,
+           &stat.watchdogCounter,
+           &stat.replayRejectedCounter,
+           &stat.replayInferredCounter,
+           &stat.shadowExecutionCounter,
+           &stat.shadowRejectedCounter,
+           &stat.shadowInferredCounter,
+           &stat.angelicExecutionCounter,
+           &stat.angelicRejectedCounter,
+           &stat.dependencyInferredCounter,
+           &stat.partitionInferredCounter,
+           &stat.partitioningEnabledCounter,
+           &stat.partitioningSampledCounter,
+           &stat.partitioningDisabledCounter,
+           &stat.sharedInferredCounter,
+           &stat.sharedSkippedCounter,
+           &stat.cacheHitCounter,
+           &stat.cacheStoredCounter,
+           &stat.retriedCounter,
+           &stat.partitioningWarmupCounter,
+           &stat.confirmationCounter,
+           &stat.confirmationTestTime };
+}
+
+
+static void writePatchID(std::ostream &out, const PatchID &id) {
+  out << id.base << " " << id.int2 << " " << id.bool2 << " " << id.cond3 << " " << id.param;
+}
+
+
+static bool readPatchID(std::istream &in, PatchID &id) {
+  return (bool) (in >> id.base >> id.int2 >> id.bool2 >> id.cond3 >> id.param);
+}
+
+
+static fs::path journalPath(const fs::path &checkpointPath) {
+  fs::path path = checkpointPath;
+  path += ".journal";
+  return path;
+}
+
+
+//NOTE: returns false if the key is not a search outcome
+static bool readOutcome(const string &key, std::istream &entry, SearchState &search) {
+  if (key == "failing") {
+    PatchID id;
+    if (readPatchID(entry, id))
+      search.failing.insert(id);
+  } else if (key == "passing") {
+    unsigned testIndex;
+    PatchID id;
+    if ((entry >> testIndex) && testIndex < search.passing.size() && readPatchID(entry, id))
+      search.passing[testIndex].insert(id);
+  } else if (key == "distance") {
+    unsigned testIndex;
+    unsigned distance;
+    PatchID id;
+    if ((entry >> testIndex >> distance) && testIndex < search.distances.size() && readPatchID(entry, id))
+      search.distances[testIndex][id] = distance;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+
+Checkpoint emptyCheckpoint(const vector<string> &tests) {
+  Checkpoint checkpoint;
+  checkpoint.stage = CheckpointStage::NONE;
+  checkpoint.fingerprint = 0;
+  for (auto &test : tests)
+    hash_combine(checkpoint.fingerprint, test);
+  checkpoint.runtimeHash = 0;
+  checkpoint.searchIndex = 0;
+  checkpoint.search.passing.resize(tests.size());
+  checkpoint.search.distances.resize(tests.size());
+  for (auto field : statisticsFields(checkpoint.search.stat))
+    *field = 0;
+  return checkpoint;
+}
+
+
+bool loadCheckpoint(const fs::path &path, Checkpoint &checkpoint) {
+  fs::ifstream in(path);
+  string line;
+  if (!in || !std::getline(in, line) || line != CHECKPOINT_HEADER)
+    return false;
+
+  while (std::getline(in, line)) {
+    std::istringstream entry(line);
+    string key;
+    entry >> key;
+    if (key == "stage") {
+      unsigned stage;
+      entry >> stage;
+      checkpoint.stage = (CheckpointStage) stage;
+    } else if (key == "fingerprint") {
+      std::size_t fingerprint;
+      entry >> fingerprint;
+      if (fingerprint != checkpoint.fingerprint) {
+        BOOST_LOG_TRIVIAL(warning) << "checkpoint was created for different tests";
+        return false;
+      }
+    } else if (key == "file") {
+      ProjectFile file;
+      string relpath;
+      entry >> file.fromLine >> file.toLine;
+      entry.get();
+      std::getline(entry, relpath);
+      file.relpath = fs::path(relpath);
+      checkpoint.files.push_back(file);
+    } else if (key == "profile") {
+      unsigned status;
+      unsigned long time;
+      entry >> status >> time;
+      checkpoint.profileStatus.push_back((TestStatus) status);
+      checkpoint.profileTime.push_back(time);
+    } else if (key == "runtime") {
+      entry >> checkpoint.runtimeHash;
+    } else if (key == "search") {
+      entry >> checkpoint.searchIndex;
+    } else if (key == "plausible") {
+      unsigned long index;
+      entry >> index;
+      checkpoint.plausible.push_back(index);
+    } else if (key == "deferred") {
+      unsigned long index;
+      entry >> index;
+      checkpoint.search.deferred.push_back(index);
+    } else if (key == "stat") {
+      for (auto field : statisticsFields(checkpoint.search.stat))
+        entry >> *field;
+    } else {
+      readOutcome(key, entry, checkpoint.search);
+    }
+  }
+
+  //NOTE: the last line of the journal is incomplete if the run was killed while writing it
+  if (checkpoint.stage == CheckpointStage::SEARCHING) {
+    fs::ifstream journal(journalPath(path));
+    unsigned long replayed = 0;
+    while (std::getline(journal, line) && !journal.eof()) {
+      std::istringstream entry(line);
+      string key;
+      entry >> key;
+      if (readOutcome(key, entry, checkpoint.search))
+        replayed++;
+    }
+    if (replayed)
+      BOOST_LOG_TRIVIAL(debug) << "outcomes replayed from checkpoint journal: " << replayed;
+  }
+  return true;
+}
+
+
+//NOTE: the checkpoint is replaced atomically, so that a killed run leaves the previous one intact
+void saveCheckpoint(const fs::path &path, const Checkpoint &checkpoint) {
+  fs::path temporary = path;
+  temporary += ".tmp";
+  {
+    fs::ofstream out(temporary);
+    out << CHECKPOINT_HEADER << "\n";
+    out << "stage " << (unsigned) checkpoint.stage << "\n";
+    out << "fingerprint " << checkpoint.fingerprint << "\n";
+    for (auto &file : checkpoint.files)
+      out << "file " << file.fromLine << " " << file.toLine << " " << file.relpath.string() << "\n";
+    for (unsigned i = 0; i < checkpoint.profileStatus.size(); i++)
+      out << "profile " << (unsigned) checkpoint.profileStatus[i] << " " << checkpoint.profileTime[i] << "\n";
+    out << "runtime " << checkpoint.runtimeHash << "\n";
+    if (checkpoint.stage == CheckpointStage::SEARCHING) {
+      out << "search " << checkpoint.searchIndex << "\n";
+      for (auto index : checkpoint.plausible)
+        out << "plausible " << index << "\n";
+      for (auto index : checkpoint.search.deferred)
+        out << "deferred " << index << "\n";
+      SearchStatistics stat = checkpoint.search.stat;
+      out << "stat";
+      for (auto field : statisticsFields(stat))
+        out << " " << *field;
+      out << "\n";
+      for (auto &id : checkpoint.search.failing) {
+        out << "failing ";
+        writePatchID(out, id);
+        out << "\n";
+      }
+      for (unsigned testIndex = 0; testIndex < checkpoint.search.passing.size(); testIndex++) {
+        for (auto &id : checkpoint.search.passing[testIndex]) {
+          out << "passing " << testIndex << " ";
+          writePatchID(out, id);
+          out << "\n";
+        }
+      }
+      for (unsigned testIndex = 0; testIndex < checkpoint.search.distances.size(); testIndex++) {
+        for (auto &entry : checkpoint.search.distances[testIndex]) {
+          out << "distance " << testIndex << " " << entry.second << " ";
+          writePatchID(out, entry.first);
+          out << "\n";
+        }
+      }
+    }
+    if (!out) {
+      BOOST_LOG_TRIVIAL(warning) << "failed to write checkpoint " << path;
+      return;
+    }
+  }
+  fs::rename(temporary, path);
+  //NOTE: the journal is truncated rather than removed, since it is kept open for appending
+  if (fs::exists(journalPath(path)))
+    fs::resize_file(journalPath(path), 0);
+  BOOST_LOG_TRIVIAL(debug) << "checkpoint saved: " << path;
+}
+
+
+CheckpointJournal::CheckpointJournal(const fs::path &checkpointPath):
+  out(journalPath(checkpointPath), std::ios::app) {}
+
+
+//NOTE: entries are flushed one by one, so that they survive when the run is killed
+void CheckpointJournal::recordOutcome(unsigned testIndex, const PatchID &id, bool passed) {
+  if (passed)
+    out << "passing " << testIndex << " ";
+  else
+    out << "failing ";
+  writePatchID(out, id);
+  out << std::endl;
+}
+
+
+void CheckpointJournal::recordDistance(unsigned testIndex, const PatchID &id, unsigned distance) {
+  out << "distance " << testIndex << " " << distance << " ";
+  writePatchID(out, id);
+  out << std::endl;
+}
@@ -0,0 +1,85 @@
+/*
+  This file is part of f1x.
+  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+
+  f1x is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <chrono>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include "Core.h"
+#include "Project.h"
+#include "SearchEngine.h"
+
+
+const std::string CHECKPOINT_FILE_NAME = "checkpoint.txt";
+
+// minimum time between checkpoints during search; outcomes are journaled in between
+const std::chrono::seconds CHECKPOINT_INTERVAL(60);
+
+// stages are completed in this order; a resumed run skips completed stages
+enum class CheckpointStage {
+  NONE = 0,
+  PROFILED = 1,    // profiling results (test outcomes and archived traces)
+  TRANSFORMED = 2, // schema applications and instrumented files
+  COMPILED = 3,    // runtime library
+  SEARCHING = 4    // search progress
+};
+
+
+/*
+  State of a repair run saved in the data directory, so that a killed run can be resumed
+  without repeating test executions. Candidates are referred to by their position in the
+  prioritized search space, which is deterministic for the same checkpoint. During search, test
+  outcomes are also appended to a journal as they are recorded, so that a killed run loses no
+  executions; the journal is replayed when loading and emptied when the checkpoint is saved.
+ */
+struct Checkpoint {
+  CheckpointStage stage;
+  std::size_t fingerprint; // of the tests
+  std::vector<ProjectFile> files;
+  std::vector<TestStatus> profileStatus;
+  std::vector<unsigned long> profileTime;
+  std::size_t runtimeHash;
+  unsigned long searchIndex;
+  std::vector<unsigned long> plausible;
+  SearchState search;
+};
+
+
+Checkpoint emptyCheckpoint(const std::vector<std::string> &tests);
+
+//NOTE: the checkpoint is expected to be initialized with emptyCheckpoint for the same tests
+bool loadCheckpoint(const boost::filesystem::path &path, Checkpoint &checkpoint);
+
+void saveCheckpoint(const boost::filesystem::path &path, const Checkpoint &checkpoint);
+
+
+class CheckpointJournal {
+ public:
+  CheckpointJournal(const boost::filesystem::path &checkpointPath);
+  void recordOutcome(unsigned testIndex, const PatchID &id, bool passed);
+  void recordDistance(unsigned testIndex, const PatchID &id, unsigned distance);
+
+ private:
+  boost::filesystem::ofstream out;
+};
@@ -41,7 +41,7 @@ const unsigned NO_NEGATIVE_TESTS_EXIT_CODE = 123;
 
 enum class TestPrioritization {
   FIXED_ORDER, // first run failing, then passing tests
-  MAX_FAILING  // dynamically prioritize tests based on previous failures
+  MAX_FAILING  // dynamically prioritize tests by expected rejections per unit of time
 };
 
 
@@ -195,6 +195,9 @@ struct SchemaApplication {
   Expression original;
   std::vector<Expression> components;
   std::vector<std::string> completePointeeTypes; // for pointer arithmetic
+  std::vector<unsigned long> literals; // integer literals of the source file
+  std::vector<unsigned long> parameterDomain; // empty means the default range
+  std::vector<std::string> redundantComponents; // not used for synthesis
 };
 
 
@@ -0,0 +1,528 @@
+/*
+  This file is part of f1x.
+  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+
+  f1x is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <boost/log/trivial.hpp>
+
+#include "Distributed.h"
+
+using std::string;
+using std::vector;
+using std::to_string;
+
+// maximum number of indexes in one outcome message
+const unsigned long MAX_OUTCOME_INDEXES = 4096;
+
+
+LineChannel::LineChannel(int fd): fd(fd) {}
+
+
+bool LineChannel::receive() {
+  char data[4096];
+  ssize_t count;
+  do {
+    count = read(fd, data, sizeof(data));
+  } while (count == -1 && errno == EINTR);
+  if (count <= 0)
+    return false;
+  buffer.append(data, count);
+  return true;
+}
+
+
+bool LineChannel::nextLine(string &line) {
+  std::size_t newline = buffer.find('\n');
+  if (newline == string::npos)
+    return false;
+  line = buffer.substr(0, newline);
+  buffer.erase(0, newline + 1);
+  return true;
+}
+
+
+bool LineChannel::readLine(string &line) {
+  while (!nextLine(line)) {
+    if (!receive())
+      return false;
+  }
+  return true;
+}
+
+
+bool LineChannel::writeLine(const string &line) {
+  string data = line + "\n";
+  std::size_t written = 0;
+  while (written < data.size()) {
+    ssize_t count = send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+    if (count == -1 && errno == EINTR)
+      continue;
+    if (count <= 0)
+      return false;
+    written += count;
+  }
+  return true;
+}
+
+
+int LineChannel::getFd() {
+  return fd;
+}
+
+
+void LineChannel::close() {
+  if (fd != -1)
+    ::close(fd);
+  fd = -1;
+}
+
+
+SearchCoordinator::SearchCoordinator(unsigned short port, unsigned long size, std::size_t fingerprint):
+  port(port),
+  size(size),
+  fingerprint(fingerprint),
+  listenFd(-1),
+  explored(size, false),
+  plausible(size, false),
+  failing(size, false),
+  committed(0),
+  reported(0) {
+  if (size > 0)
+    unassigned[0] = size;
+}
+
+
+//NOTE: workers see the closed connection as the end of the search
+SearchCoordinator::~SearchCoordinator() {
+  for (auto &entry : workers)
+    entry.second.channel.close();
+  if (listenFd != -1)
+    close(listenFd);
+}
+
+
+bool SearchCoordinator::start() {
+  listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenFd == -1) {
+    BOOST_LOG_TRIVIAL(error) << "failed to create coordinator socket";
+    return false;
+  }
+  int reuse = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+  if (bind(listenFd, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(listenFd, SOMAXCONN) != 0) {
+    BOOST_LOG_TRIVIAL(error) << "failed to listen on port " << port;
+    close(listenFd);
+    listenFd = -1;
+    return false;
+  }
+  BOOST_LOG_TRIVIAL(info) << "coordinating search on port " << port;
+  return true;
+}
+
+
+unsigned long SearchCoordinator::findNext() {
+  while (true) {
+    while (reported < committed) {
+      unsigned long index = reported;
+      reported++;
+      if (plausible[index])
+        return index;
+    }
+    if (committed >= size)
+      return size;
+    serve();
+  }
+}
+
+
+vector<std::pair<unsigned, unsigned>> SearchCoordinator::getDistances(unsigned long index) {
+  auto found = distances.find(index);
+  if (found == distances.end())
+    return {};
+  return found->second;
+}
+
+
+void SearchCoordinator::serve() {
+  vector<struct pollfd> fds;
+  fds.push_back({listenFd, POLLIN, 0});
+  for (auto &entry : workers)
+    fds.push_back({entry.first, POLLIN, 0});
+
+  int ready = poll(fds.data(), fds.size(), DISTRIBUTED_POLL_TIMEOUT);
+  if (ready <= 0)
+    return;
+
+  if (fds[0].revents & POLLIN) {
+    int fd = accept(listenFd, NULL, NULL);
+    if (fd != -1) {
+      BOOST_LOG_TRIVIAL(debug) << "worker connected";
+      workers.emplace(fd, Worker{LineChannel(fd), false, 0, 0});
+    }
+  }
+
+  for (unsigned i = 1; i < fds.size(); i++) {
+    if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+      continue;
+    auto entry = workers.find(fds[i].fd);
+    Worker &worker = entry->second;
+    bool alive = worker.channel.receive();
+    string line;
+    while (alive && worker.channel.nextLine(line)) {
+      alive = handle(worker, line);
+    }
+    if (!alive) {
+      BOOST_LOG_TRIVIAL(debug) << "worker disconnected";
+      release(worker);
+      worker.channel.close();
+      workers.erase(entry);
+    }
+  }
+}
+
+
+bool SearchCoordinator::handle(Worker &worker, const string &line) {
+  std::istringstream in(line);
+  string command;
+  in >> command;
+
+  if (command == "HELLO") {
+    std::size_t otherFingerprint = 0;
+    unsigned long otherSize = 0;
+    in >> otherFingerprint >> otherSize;
+    if (otherFingerprint == fingerprint && otherSize == size) {
+      worker.accepted = true;
+      return worker.channel.writeLine("OK");
+    }
+    BOOST_LOG_TRIVIAL(warning) << "rejected worker with different search space";
+    worker.channel.writeLine("REJECT");
+    return false;
+  }
+
+  if (!worker.accepted)
+    return false;
+
+  if (command == "NEXT") {
+    release(worker);
+    assign(worker);
+    return true;
+  }
+
+  if (command == "OUTCOME") {
+    unsigned test;
+    string result;
+    unsigned long index;
+    in >> test >> result;
+    while (in >> index) {
+      if (index >= size)
+        continue;
+      if (result == "F")
+        failing[index] = true;
+      else
+        passing[index].push_back(test);
+    }
+    return true;
+  }
+
+  if (command == "DISTANCE") {
+    unsigned long index = size;
+    unsigned test;
+    unsigned distance;
+    if (in >> index >> test >> distance && index < size)
+      distances[index].push_back(std::make_pair(test, distance));
+    return true;
+  }
+
+  if (command == "EXPLORED") {
+    unsigned long index = size;
+    unsigned found = 0;
+    in >> index >> found;
+    if (index < size && !explored[index]) {
+      explored[index] = true;
+      plausible[index] = found;
+    }
+    if (index == worker.next && worker.next < worker.end)
+      worker.next++;
+    while (committed < size && explored[committed])
+      committed++;
+    return worker.channel.writeLine("CONTINUE " + to_string(worker.end));
+  }
+
+  return false;
+}
+
+
+//NOTE: a worker's range ends at the index it explores, so a stolen range is never explored twice
+void SearchCoordinator::assign(Worker &worker) {
+  unsigned long begin;
+  unsigned long end;
+  if (!unassigned.empty()) {
+    auto first = unassigned.begin();
+    begin = first->first;
+    end = std::min(first->second, begin + DISTRIBUTED_CHUNK_SIZE);
+    unsigned long rangeEnd = first->second;
+    unassigned.erase(first);
+    if (end < rangeEnd)
+      unassigned[end] = rangeEnd;
+  } else {
+    Worker *victim = nullptr;
+    unsigned long largest = 0;
+    for (auto &entry : workers) {
+      Worker &other = entry.second;
+      if (&other == &worker || other.next >= other.end)
+        continue;
+      unsigned long remaining = other.end - other.next - 1;
+      if (remaining >= 2 && remaining > largest) {
+        largest = remaining;
+        victim = &other;
+      }
+    }
+    if (!victim) {
+      worker.channel.writeLine(committed >= size ? "DONE" : "WAIT");
+      return;
+    }
+    end = victim->end;
+    begin = end - largest / 2;
+    victim->end = begin;
+    BOOST_LOG_TRIVIAL(debug) << "stolen candidates " << begin << "-" << end;
+  }
+
+  worker.next = begin;
+  worker.end = end;
+
+  std::ostringstream failingLine;
+  std::map<unsigned, vector<unsigned long>> passingByTest;
+  failingLine << "FAILING";
+  for (unsigned long index = begin; index < end; index++) {
+    if (failing[index])
+      failingLine << " " << index;
+    auto known = passing.find(index);
+    if (known != passing.end()) {
+      for (auto test : known->second)
+        passingByTest[test].push_back(index);
+    }
+  }
+
+  worker.channel.writeLine("CHUNK " + to_string(begin) + " " + to_string(end));
+  worker.channel.writeLine(failingLine.str());
+  for (auto &entry : passingByTest) {
+    std::ostringstream passingLine;
+    passingLine << "PASSING " << entry.first;
+    for (auto index : entry.second)
+      passingLine << " " << index;
+    worker.channel.writeLine(passingLine.str());
+  }
+  worker.channel.writeLine("END");
+}
+
+
+void SearchCoordinator::release(Worker &worker) {
+  if (worker.next < worker.end)
+    unassigned[worker.next] = worker.end;
+  worker.next = 0;
+  worker.end = 0;
+}
+
+
+SearchWorker::SearchWorker(const string &address,
+                           unsigned long size,
+                           std::size_t fingerprint,
+                           std::function<void(unsigned, unsigned long, bool)> learn):
+  address(address),
+  size(size),
+  fingerprint(fingerprint),
+  learn(learn),
+  channel(-1),
+  next(0),
+  end(0),
+  finished(false) {}
+
+
+SearchWorker::~SearchWorker() {
+  channel.close();
+}
+
+
+bool SearchWorker::connect() {
+  std::size_t separator = address.rfind(':');
+  if (separator == string::npos) {
+    BOOST_LOG_TRIVIAL(error) << "coordinator address is not HOST:PORT: " << address;
+    return false;
+  }
+  string host = address.substr(0, separator);
+  string port = address.substr(separator + 1);
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo *addresses = NULL;
+  if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+    BOOST_LOG_TRIVIAL(error) << "failed to resolve coordinator " << address;
+    return false;
+  }
+  int fd = -1;
+  for (struct addrinfo *current = addresses; current; current = current->ai_next) {
+    fd = socket(current->ai_family, current->ai_socktype, current->ai_protocol);
+    if (fd == -1)
+      continue;
+    if (::connect(fd, current->ai_addr, current->ai_addrlen) == 0)
+      break;
+    ::close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addresses);
+  if (fd == -1) {
+    BOOST_LOG_TRIVIAL(error) << "failed to connect to coordinator " << address;
+    return false;
+  }
+
+  channel = LineChannel(fd);
+  string reply;
+  if (!channel.writeLine("HELLO " + to_string(fingerprint) + " " + to_string(size)) ||
+      !channel.readLine(reply) || reply != "OK") {
+    BOOST_LOG_TRIVIAL(error) << "coordinator " << address << " rejected the search space";
+    channel.close();
+    return false;
+  }
+  BOOST_LOG_TRIVIAL(info) << "connected to coordinator " << address;
+  return true;
+}
+
+
+unsigned long SearchWorker::findNext(std::function<bool(unsigned long)> explore) {
+  while (!finished) {
+    if (next >= end && !request()) {
+      finished = true;
+      break;
+    }
+    unsigned long index = next;
+    bool found = explore(index);
+
+    string reply;
+    if (!flush() ||
+        !channel.writeLine("EXPLORED " + to_string(index) + " " + (found ? "1" : "0")) ||
+        !channel.readLine(reply)) {
+      finished = true;
+    } else {
+      std::istringstream in(reply);
+      string command;
+      in >> command >> end;
+      if (command != "CONTINUE")
+        finished = true;
+      next = index + 1;
+    }
+
+    if (found)
+      return index;
+  }
+  return size;
+}
+
+
+void SearchWorker::record(unsigned testIndex, unsigned long index, bool passed) {
+  recorded[std::make_pair(testIndex, passed)].push_back(index);
+}
+
+
+void SearchWorker::recordDistance(unsigned testIndex, unsigned long index, unsigned distance) {
+  recordedDistances.push_back("DISTANCE " + to_string(index) + " " +
+                              to_string(testIndex) + " " + to_string(distance));
+}
+
+
+bool SearchWorker::request() {
+  while (true) {
+    string line;
+    if (!channel.writeLine("NEXT") || !channel.readLine(line))
+      return false;
+    std::istringstream in(line);
+    string command;
+    in >> command;
+    if (command == "WAIT") {
+      std::this_thread::sleep_for(std::chrono::milliseconds(DISTRIBUTED_WAIT_TIME));
+      continue;
+    }
+    if (command != "CHUNK")
+      return false;
+    in >> next >> end;
+    BOOST_LOG_TRIVIAL(debug) << "received candidates " << next << "-" << end;
+
+    while (channel.readLine(line)) {
+      std::istringstream known(line);
+      known >> command;
+      unsigned long index;
+      if (command == "END") {
+        return next < end && end <= size;
+      } else if (command == "FAILING") {
+        while (known >> index) {
+          if (index < size)
+            learn(0, index, false);
+        }
+      } else if (command == "PASSING") {
+        unsigned test;
+        known >> test;
+        while (known >> index) {
+          if (index < size)
+            learn(test, index, true);
+        }
+      }
+    }
+    return false;
+  }
+}
+
+
+bool SearchWorker::flush() {
+  for (auto &entry : recorded) {
+    for (unsigned long offset = 0; offset < entry.second.size(); offset += MAX_OUTCOME_INDEXES) {
+      std::ostringstream line;
+      line << "OUTCOME " << entry.first.first << " " << (entry.first.second ? "P" : "F");
+      unsigned long last = std::min((unsigned long) entry.second.size(), offset + MAX_OUTCOME_INDEXES);
+      for (unsigned long i = offset; i < last; i++)
+        line << " " << entry.second[i];
+      if (!channel.writeLine(line.str()))
+        return false;
+    }
+  }
+  recorded.clear();
+  for (auto &line : recordedDistances) {
+    if (!channel.writeLine(line))
+      return false;
+  }
+  recordedDistances.clear();
+  return true;
+}
@@ -0,0 +1,141 @@
+/*
+  This file is part of f1x.
+  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+
+  f1x is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <cstddef>
+
+
+/*
+  Distributed search over build-identical hosts. Every process runs the same pipeline up to the
+  prioritized search space, which is checked with a fingerprint. The coordinator serves chunks of
+  candidate indexes in cost order to workers over TCP; when no unassigned chunk is left, an idle
+  worker steals the second half of the largest remaining range of a busy worker. Workers stream
+  back the explored indexes and the test outcomes they inferred (including partitions), which the
+  coordinator forwards with later chunks. Plausible patches are committed in cost order, once all
+  cheaper candidates are explored. Since the coordinator executes no tests, workers also send the
+  semantic distances of plausible patches, which are needed to rank them.
+
+  The protocol is line-based; worker requests and coordinator replies are:
+    HELLO <fingerprint> <size>        OK | REJECT
+    NEXT                              CHUNK <begin> <end>, [PASSING <test> <index>... | FAILING <index>...]*, END
+                                      | WAIT | DONE
+    OUTCOME <test> P|F <index>...     (no reply)
+    DISTANCE <index> <test> <dist>    (no reply)
+    EXPLORED <index> <plausible>      CONTINUE <end>
+ */
+
+const unsigned long DISTRIBUTED_CHUNK_SIZE = 64;
+const unsigned DISTRIBUTED_POLL_TIMEOUT = 1000; // milliseconds
+const unsigned DISTRIBUTED_WAIT_TIME = 200;     // milliseconds
+
+
+class LineChannel {
+ public:
+  LineChannel(int fd);
+  bool receive();
+  bool nextLine(std::string &line);
+  bool readLine(std::string &line);
+  bool writeLine(const std::string &line);
+  int getFd();
+  void close();
+
+ private:
+  int fd;
+  std::string buffer;
+};
+
+
+class SearchCoordinator {
+ public:
+  SearchCoordinator(unsigned short port, unsigned long size, std::size_t fingerprint);
+  ~SearchCoordinator();
+  SearchCoordinator(const SearchCoordinator&) = delete;
+  SearchCoordinator &operator=(const SearchCoordinator&) = delete;
+
+  bool start();
+  unsigned long findNext();
+  //NOTE: (test, distance) pairs reported for a plausible candidate
+  std::vector<std::pair<unsigned, unsigned>> getDistances(unsigned long index);
+
+ private:
+  struct Worker {
+    LineChannel channel;
+    bool accepted;
+    unsigned long next; // index being explored
+    unsigned long end;
+  };
+
+  void serve();
+  bool handle(Worker &worker, const std::string &line);
+  void assign(Worker &worker);
+  void release(Worker &worker);
+
+  unsigned short port;
+  unsigned long size;
+  std::size_t fingerprint;
+  int listenFd;
+  std::map<int, Worker> workers;
+  std::map<unsigned long, unsigned long> unassigned; // begin -> end
+  std::vector<bool> explored;
+  std::vector<bool> plausible;
+  std::vector<bool> failing;
+  std::unordered_map<unsigned long, std::vector<unsigned>> passing;
+  std::unordered_map<unsigned long, std::vector<std::pair<unsigned, unsigned>>> distances;
+  unsigned long committed;
+  unsigned long reported;
+};
+
+
+class SearchWorker {
+ public:
+  //NOTE: outcomes received from the coordinator are passed to learn; failing candidates are
+  // reported without a test
+  SearchWorker(const std::string &address,
+               unsigned long size,
+               std::size_t fingerprint,
+               std::function<void(unsigned, unsigned long, bool)> learn);
+  ~SearchWorker();
+  SearchWorker(const SearchWorker&) = delete;
+  SearchWorker &operator=(const SearchWorker&) = delete;
+
+  bool connect();
+  unsigned long findNext(std::function<bool(unsigned long)> explore);
+  void record(unsigned testIndex, unsigned long index, bool passed);
+  void recordDistance(unsigned testIndex, unsigned long index, unsigned distance);
+
+ private:
+  bool request();
+  bool flush();
+
+  std::string address;
+  unsigned long size;
+  std::size_t fingerprint;
+  std::function<void(unsigned, unsigned long, bool)> learn;
+  LineChannel channel;
+  unsigned long next;
+  unsigned long end;
+  bool finished;
+  std::map<std::pair<unsigned, bool>, std::vector<unsigned long>> recorded;
+  std::vector<std::string> recordedDistances;
+};
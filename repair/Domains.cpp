@@ -0,0 +1,136 @@
+/*
+  This file is part of f1x.
+  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+
+  f1x is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <climits>
+#include <set>
+
+#include "Domains.h"
+#include "Global.h"
+
+using std::vector;
+using std::string;
+using std::shared_ptr;
+using std::unordered_map;
+
+
+namespace {
+
+  // NOTE: parameters are unsigned, so only non-negative values are used
+  void addBoundary(std::set<unsigned long> &domain, long long value) {
+    for (long long delta = -1; delta <= 1; delta++) {
+      if ((delta < 0 && value == LLONG_MIN) || (delta > 0 && value == LLONG_MAX))
+        continue;
+      if (value + delta >= 0)
+        domain.insert((unsigned long) (value + delta));
+    }
+  }
+
+  bool sameValues(const ValueTrace &trace, unsigned long first, unsigned long second) {
+    unsigned long hits = trace.original.size();
+    for (unsigned long hit = 0; hit < hits; hit++) {
+      unsigned long i = hit * trace.numComponents + first;
+      unsigned long j = hit * trace.numComponents + second;
+      if (trace.valid[i] != trace.valid[j] || (trace.valid[i] && trace.values[i] != trace.values[j]))
+        return false;
+    }
+    return true;
+  }
+
+}
+
+
+void inferDomains(const vector<shared_ptr<SchemaApplication>> &schemaApplications,
+                  const unordered_map<Location, unordered_map<unsigned, ValueTrace>> &traces,
+                  const unordered_map<Location, vector<unsigned>> &relatedTestIndexes) {
+  for (auto &sa : schemaApplications) {
+    auto locationTraces = traces.find(sa->location);
+    auto related = relatedTestIndexes.find(sa->location);
+    if (locationTraces == traces.end() || related == relatedTestIndexes.end())
+      continue;
+    unsigned long numComponents = sa->components.size();
+    bool complete = true;
+    unsigned long hits = 0;
+    for (auto testIndex : related->second) {
+      auto trace = locationTraces->second.find(testIndex);
+      if (trace == locationTraces->second.end() || trace->second.numComponents != numComponents) {
+        complete = false;
+        break;
+      }
+      hits += trace->second.original.size();
+    }
+    if (!complete || hits == 0)
+      continue;
+
+    unsigned long paramBound;
+    if (sa->context == LocationContext::CONDITION) {
+      paramBound = cfg.maxConditionParameter;
+    } else {
+      paramBound = cfg.maxExpressionParameter;
+    }
+
+    std::set<unsigned long> domain = { 0, 1 };
+    domain.insert(sa->literals.begin(), sa->literals.end());
+    vector<bool> redundant(numComponents, false);
+    for (unsigned long c = 0; c < numComponents; c++) {
+      if (sa->components[c].type == Type::INTEGER) {
+        bool observed = false;
+        long long min = 0;
+        long long max = 0;
+        for (auto &entry : locationTraces->second) {
+          const ValueTrace &trace = entry.second;
+          for (unsigned long hit = 0; hit < trace.original.size(); hit++) {
+            unsigned long i = hit * numComponents + c;
+            if (!trace.valid[i])
+              continue;
+            if (!observed || trace.values[i] < min)
+              min = trace.values[i];
+            if (!observed || trace.values[i] > max)
+              max = trace.values[i];
+            observed = true;
+          }
+        }
+        if (observed) {
+          addBoundary(domain, min);
+          addBoundary(domain, max);
+        }
+      }
+
+      //NOTE: components are compared only in the original execution, candidates may distinguish them later
+      for (unsigned long other = 0; other < c && !redundant[c]; other++) {
+        if (redundant[other] ||
+            sa->components[other].type != sa->components[c].type ||
+            sa->components[other].kind != sa->components[c].kind ||
+            sa->components[other].rawType != sa->components[c].rawType)
+          continue;
+        redundant[c] = std::all_of(related->second.begin(), related->second.end(), [&](unsigned testIndex) {
+            return sameValues(locationTraces->second.at(testIndex), other, c);
+          });
+      }
+      if (redundant[c])
+        sa->redundantComponents.push_back(sa->components[c].repr);
+    }
+
+    // the domain is never larger than the default one
+    for (auto value : domain) {
+      if (sa->parameterDomain.size() > paramBound)
+        break;
+      sa->parameterDomain.push_back(value);
+    }
+  }
+}
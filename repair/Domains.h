@@ -0,0 +1,39 @@
+/*
+  This file is part of f1x.
+  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+
+  f1x is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+#include "Core.h"
+#include "Profiler.h"
+
+
+/*
+  Synthesis domains of locations are refined using component values recorded during profiling:
+  - parameters range over small constants, literals of the source file and boundaries
+    (+-1) of observed component values instead of the default range;
+  - components that hold the same values as another component at every hit in every
+    related test are not used for synthesis.
+  Locations whose values are not recorded for all related tests keep the default domains.
+ */
+void inferDomains(const std::vector<std::shared_ptr<SchemaApplication>> &schemaApplications,
+                  const std::unordered_map<Location, std::unordered_map<unsigned, ValueTrace>> &traces,
+                  const std::unordered_map<Location, std::vector<unsigned>> &relatedTestIndexes);
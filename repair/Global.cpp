@@ -28,6 +28,11 @@ struct Config cfg = {
   /* generateAll            = */ false,
   /* searchSpaceFile        = */ "",
   /* statisticsFile         = */ "",
+  /* outcomeTable           = */ "",
+  /* outcomeCache           = */ "",
+  /* coordinatorPort        = */ 0,
+  /* coordinatorAddress     = */ "",
+  /* resume                 = */ false,
   /* dataDir                = */ "",
   /* outputPatchMetadata    = */ false,
   /* removeIntermediateData = */ false,
@@ -35,6 +40,8 @@ struct Config cfg = {
   /* addGuards              = */ true,
   /* maxConditionParameter  = */ 64,
   /* maxExpressionParameter = */ 1,
+  /* maxComponents          = */ 32,
+  /* jobs                   = */ 0,
   /* valueTEQ               = */ true,
   /* dependencyTEQ          = */ true,
   /* testPrioritization     = */ TestPrioritization::MAX_FAILING,
@@ -42,5 +49,10 @@ struct Config cfg = {
   /* filesToLocalize        = */ 10,
   /* useLLVMCov             = */ false,
   /* outputOnePerLocation   = */ false,
-  /* outputTop              = */ 0
+  /* outputTop              = */ 0,
+  /* adaptiveTimeout        = */ true,
+  /* valueReplay            = */ true,
+  /* shadowEvaluation       = */ true,
+  /* angelicSearch          = */ true,
+  /* valueDomains           = */ true
 };
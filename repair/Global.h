@@ -30,6 +30,11 @@ struct Config {
   bool generateAll;
   std::string searchSpaceFile;
   std::string statisticsFile;
+  std::string outcomeTable;
+  std::string outcomeCache;
+  unsigned coordinatorPort;
+  std::string coordinatorAddress;
+  bool resume;
   std::string dataDir;
   bool outputPatchMetadata;
   bool removeIntermediateData;
@@ -37,6 +42,8 @@ struct Config {
   bool addGuards;
   unsigned maxConditionParameter;
   unsigned maxExpressionParameter;
+  unsigned maxComponents;
+  unsigned jobs;
   bool valueTEQ;
   bool dependencyTEQ;
   TestPrioritization testPrioritization;
@@ -45,6 +52,11 @@ struct Config {
   bool useLLVMCov;
   bool outputOnePerLocation;
   signed outputTop;
+  bool adaptiveTimeout;
+  bool valueReplay;
+  bool shadowEvaluation;
+  bool angelicSearch;
+  bool valueDomains;
 };
 
 
@@ -0,0 +1,285 @@
+/*
+  This file is part of f1x.
+  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+
+  f1x is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <boost/log/trivial.hpp>
+
+#include "OutcomeCache.h"
+
+
+const char OUTCOME_CACHE_MAGIC[8] = {'F', '1', 'X', 'C', 'A', 'C', 'H', '1'};
+
+// the table is rewritten with twice the capacity when it is filled to this fraction
+const unsigned long OUTCOME_CACHE_LOAD_NUMERATOR = 3;
+const unsigned long OUTCOME_CACHE_LOAD_DENOMINATOR = 4;
+
+struct OutcomeCacheHeader {
+  char magic[8];
+  unsigned long capacity;
+  unsigned long count;
+  unsigned long obsolete; // set when the table was replaced by a larger one
+};
+
+//NOTE: key 0 marks an empty entry; the outcome is stored before the key, so that a visible key
+// always has an outcome
+struct OutcomeCacheEntry {
+  unsigned long key;
+  unsigned long outcome;
+};
+
+
+static unsigned long normalizeKey(std::size_t key) {
+  return key == 0 ? 1 : key;
+}
+
+
+static OutcomeCacheHeader *header(void *memory) {
+  return (OutcomeCacheHeader*) memory;
+}
+
+
+static OutcomeCacheEntry *entries(void *memory) {
+  return (OutcomeCacheEntry*) (header(memory) + 1);
+}
+
+
+static std::size_t tableSize(unsigned long capacity) {
+  return sizeof(OutcomeCacheHeader) + capacity * sizeof(OutcomeCacheEntry);
+}
+
+
+static bool initialize(int fd, unsigned long capacity) {
+  if (ftruncate(fd, tableSize(capacity)) != 0)
+    return false;
+  OutcomeCacheHeader init;
+  memset(&init, 0, sizeof(init));
+  memcpy(init.magic, OUTCOME_CACHE_MAGIC, sizeof(OUTCOME_CACHE_MAGIC));
+  init.capacity = capacity;
+  return pwrite(fd, &init, sizeof(init), 0) == sizeof(init);
+}
+
+
+OutcomeCache::OutcomeCache(const std::string &path):
+  path(path),
+  memory(NULL),
+  size(0),
+  device(0),
+  inode(0) {
+  reopen();
+}
+
+
+OutcomeCache::~OutcomeCache() {
+  unmap();
+}
+
+
+bool OutcomeCache::map(int fd) {
+  struct stat sb;
+  fstat(fd, &sb);
+  if ((std::size_t) sb.st_size < sizeof(OutcomeCacheHeader))
+    return false;
+  void *mapped = mmap(NULL, sb.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mapped == MAP_FAILED)
+    return false;
+  if (memcmp(header(mapped)->magic, OUTCOME_CACHE_MAGIC, sizeof(OUTCOME_CACHE_MAGIC)) != 0 ||
+      tableSize(header(mapped)->capacity) != (std::size_t) sb.st_size) {
+    munmap(mapped, sb.st_size);
+    return false;
+  }
+  memory = mapped;
+  size = sb.st_size;
+  device = sb.st_dev;
+  inode = sb.st_ino;
+  return true;
+}
+
+
+void OutcomeCache::unmap() {
+  if (memory)
+    munmap(memory, size);
+  memory = NULL;
+  size = 0;
+  device = 0;
+  inode = 0;
+}
+
+
+//NOTE: the file is locked while it is created, so that concurrent runs see a complete header
+bool OutcomeCache::reopen() {
+  unmap();
+  int fd = open(path.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+  if (fd == -1) {
+    BOOST_LOG_TRIVIAL(warning) << "failed to open outcome cache " << path;
+    return false;
+  }
+  flock(fd, LOCK_EX);
+  struct stat sb;
+  fstat(fd, &sb);
+  bool created = (sb.st_size == 0);
+  if (created && !initialize(fd, OUTCOME_CACHE_INITIAL_CAPACITY)) {
+    BOOST_LOG_TRIVIAL(warning) << "failed to allocate outcome cache " << path;
+  } else if (!map(fd)) {
+    BOOST_LOG_TRIVIAL(warning) << "file " << path << " is not an outcome cache";
+  }
+  flock(fd, LOCK_UN);
+  close(fd);
+  return memory != NULL;
+}
+
+
+bool OutcomeCache::isOpen() {
+  return memory != NULL;
+}
+
+
+unsigned long OutcomeCache::getSize() {
+  return memory ? __atomic_load_n(&header(memory)->count, __ATOMIC_ACQUIRE) : 0;
+}
+
+
+Outcome OutcomeCache::get(std::size_t key) {
+  if (!memory)
+    return Outcome::UNKNOWN;
+  if (__atomic_load_n(&header(memory)->obsolete, __ATOMIC_ACQUIRE) && !reopen())
+    return Outcome::UNKNOWN;
+
+  unsigned long k = normalizeKey(key);
+  unsigned long mask = header(memory)->capacity - 1;
+  OutcomeCacheEntry *table = entries(memory);
+  for (unsigned long i = k & mask; ; i = (i + 1) & mask) {
+    unsigned long current = __atomic_load_n(&table[i].key, __ATOMIC_ACQUIRE);
+    if (current == 0)
+      return Outcome::UNKNOWN;
+    if (current == k)
+      return (Outcome) table[i].outcome;
+  }
+}
+
+
+//NOTE: the new table is complete before it replaces the file, and the old one is marked obsolete
+// only after that, so lookups in other processes never see a partial table
+bool OutcomeCache::grow() {
+  unsigned long capacity = header(memory)->capacity * 2;
+  std::string temporary = path + ".tmp";
+  int tfd = open(temporary.c_str(), O_CREAT | O_TRUNC | O_RDWR, S_IRUSR | S_IWUSR);
+  if (tfd == -1)
+    return false;
+  if (!initialize(tfd, capacity)) {
+    close(tfd);
+    unlink(temporary.c_str());
+    return false;
+  }
+  void *mapped = mmap(NULL, tableSize(capacity), PROT_READ | PROT_WRITE, MAP_SHARED, tfd, 0);
+  close(tfd);
+  if (mapped == MAP_FAILED) {
+    unlink(temporary.c_str());
+    return false;
+  }
+
+  unsigned long mask = capacity - 1;
+  OutcomeCacheEntry *from = entries(memory);
+  OutcomeCacheEntry *to = entries(mapped);
+  for (unsigned long j = 0; j < header(memory)->capacity; j++) {
+    if (from[j].key == 0)
+      continue;
+    unsigned long i = from[j].key & mask;
+    while (to[i].key != 0)
+      i = (i + 1) & mask;
+    to[i] = from[j];
+  }
+  header(mapped)->count = header(memory)->count;
+
+  //NOTE: the lock of the old file is held until it is marked obsolete, so that waiting writers remap
+  if (rename(temporary.c_str(), path.c_str()) != 0) {
+    munmap(mapped, tableSize(capacity));
+    unlink(temporary.c_str());
+    return false;
+  }
+  __atomic_store_n(&header(memory)->obsolete, 1, __ATOMIC_RELEASE);
+  unmap();
+  struct stat sb;
+  stat(path.c_str(), &sb);
+  memory = mapped;
+  size = tableSize(capacity);
+  device = sb.st_dev;
+  inode = sb.st_ino;
+  BOOST_LOG_TRIVIAL(debug) << "outcome cache grown to " << capacity << " entries";
+  return true;
+}
+
+
+bool OutcomeCache::put(std::size_t key, Outcome outcome) {
+  if (!memory || (outcome != Outcome::PASS && outcome != Outcome::FAIL))
+    return false;
+
+  //NOTE: the file can be replaced by another process, then the mapping is renewed and the new
+  // file is locked instead; after growing, the new file is locked in the next iteration
+  while (true) {
+    int fd = open(path.c_str(), O_RDWR);
+    if (fd == -1)
+      return false;
+    flock(fd, LOCK_EX);
+    struct stat sb;
+    fstat(fd, &sb);
+    if ((unsigned long) sb.st_dev != device || (unsigned long) sb.st_ino != inode ||
+        __atomic_load_n(&header(memory)->obsolete, __ATOMIC_ACQUIRE)) {
+      flock(fd, LOCK_UN);
+      close(fd);
+      if (!reopen())
+        return false;
+      continue;
+    }
+
+    OutcomeCacheHeader *h = header(memory);
+    if ((h->count + 1) * OUTCOME_CACHE_LOAD_DENOMINATOR > h->capacity * OUTCOME_CACHE_LOAD_NUMERATOR) {
+      bool grown = grow();
+      flock(fd, LOCK_UN);
+      close(fd);
+      if (!grown) {
+        BOOST_LOG_TRIVIAL(warning) << "failed to grow outcome cache " << path;
+        return false;
+      }
+      continue;
+    }
+
+    bool added = false;
+    unsigned long k = normalizeKey(key);
+    unsigned long mask = h->capacity - 1;
+    OutcomeCacheEntry *table = entries(memory);
+    unsigned long i = k & mask;
+    while (table[i].key != 0 && table[i].key != k)
+      i = (i + 1) & mask;
+    if (table[i].key == 0) {
+      table[i].outcome = (unsigned long) outcome;
+      __atomic_store_n(&table[i].key, k, __ATOMIC_RELEASE);
+      __atomic_store_n(&h->count, h->count + 1, __ATOMIC_RELEASE);
+      added = true;
+    }
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    return added;
+  }
+}
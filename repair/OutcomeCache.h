@@ -0,0 +1,62 @@
+/*
+  This file is part of f1x.
+  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+
+  f1x is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+#include "OutcomeTable.h"
+
+
+// initial number of entries of a new cache file, must be a power of two
+const unsigned long OUTCOME_CACHE_INITIAL_CAPACITY = 1 << 16;
+
+
+/*
+  Test outcomes persisted across repair runs. The cache is a memory-mapped open-addressing
+  hash table from 64-bit keys to outcomes, so lookups do not read the file. Keys hash the
+  meta-program, the candidate, the test and the timeout, so a changed program or timeout
+  does not reuse outcomes. Insertions are serialized with a file lock; when the table grows,
+  it is rewritten to a new file and the old one is marked obsolete, so that other processes
+  remap it.
+ */
+class OutcomeCache {
+ public:
+  OutcomeCache(const std::string &path);
+  ~OutcomeCache();
+  OutcomeCache(const OutcomeCache&) = delete;
+  OutcomeCache &operator=(const OutcomeCache&) = delete;
+
+  bool isOpen();
+  unsigned long getSize();
+  Outcome get(std::size_t key);
+  bool put(std::size_t key, Outcome outcome);
+
+ private:
+  std::string path;
+  void *memory;
+  std::size_t size;
+  unsigned long device; // of the mapped file, to detect that the path was replaced
+  unsigned long inode;
+
+  bool map(int fd);
+  void unmap();
+  bool reopen();
+  bool grow();
+};
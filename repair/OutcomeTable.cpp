@@ -0,0 +1,193 @@
+/*
+  This file is part of f1x.
+  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+
+  f1x is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <boost/log/trivial.hpp>
+
+#include "OutcomeTable.h"
+
+
+const char OUTCOME_TABLE_MAGIC[8] = {'F', '1', 'X', 'O', 'U', 'T', 'C', '2'};
+
+const uint32_t OUTCOME_MASK = 0xff;
+const unsigned OWNER_SHIFT = 8;
+
+struct OutcomeTableHeader {
+  char magic[8];
+  unsigned long tests;
+  unsigned long candidates;
+  unsigned long fingerprint;
+};
+
+
+//NOTE: the file is locked only while it is created or checked, so that concurrent workers see
+// a complete header; a table created for another search space is rejected
+OutcomeTable::OutcomeTable(const std::string &path,
+                           unsigned numTests,
+                           unsigned long numCandidates,
+                           std::size_t fingerprint):
+  numTests(numTests),
+  numCandidates(numCandidates),
+  memory(NULL),
+  size(sizeof(OutcomeTableHeader) + sizeof(uint32_t) * numTests * numCandidates),
+  outcomes(NULL),
+  ownClaim(((uint32_t) getpid() << OWNER_SHIFT) | (uint32_t) Outcome::CLAIMED) {
+
+  int fd = open(path.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+  if (fd == -1) {
+    BOOST_LOG_TRIVIAL(warning) << "failed to open outcome table " << path;
+    return;
+  }
+  flock(fd, LOCK_EX);
+
+  struct stat sb;
+  fstat(fd, &sb);
+  bool created = (sb.st_size == 0);
+  if (created && ftruncate(fd, size) != 0) {
+    BOOST_LOG_TRIVIAL(warning) << "failed to allocate outcome table " << path;
+    flock(fd, LOCK_UN);
+    close(fd);
+    return;
+  }
+  if (!created && (std::size_t) sb.st_size != size) {
+    BOOST_LOG_TRIVIAL(warning) << "outcome table " << path << " belongs to another search space";
+    flock(fd, LOCK_UN);
+    close(fd);
+    return;
+  }
+
+  void *mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mapped == MAP_FAILED) {
+    BOOST_LOG_TRIVIAL(warning) << "failed to map outcome table " << path;
+    flock(fd, LOCK_UN);
+    close(fd);
+    return;
+  }
+
+  OutcomeTableHeader *header = (OutcomeTableHeader*) mapped;
+  if (created) {
+    header->tests = numTests;
+    header->candidates = numCandidates;
+    header->fingerprint = fingerprint;
+    memcpy(header->magic, OUTCOME_TABLE_MAGIC, sizeof(OUTCOME_TABLE_MAGIC));
+  } else if (memcmp(header->magic, OUTCOME_TABLE_MAGIC, sizeof(OUTCOME_TABLE_MAGIC)) != 0 ||
+             header->tests != numTests ||
+             header->candidates != numCandidates ||
+             header->fingerprint != fingerprint) {
+    BOOST_LOG_TRIVIAL(warning) << "outcome table " << path << " belongs to another search space";
+    munmap(mapped, size);
+    flock(fd, LOCK_UN);
+    close(fd);
+    return;
+  }
+
+  memory = mapped;
+  outcomes = (uint32_t*) (header + 1);
+
+  //NOTE: claims of workers that were terminated before publishing their outcomes
+  unsigned long released = 0;
+  if (!created) {
+    for (std::size_t i = 0; i < (std::size_t) numTests * numCandidates; i++) {
+      uint32_t value = __atomic_load_n(outcomes + i, __ATOMIC_ACQUIRE);
+      if (isStaleClaim(value) && __sync_bool_compare_and_swap(outcomes + i, value, (uint32_t) Outcome::UNKNOWN))
+        released++;
+    }
+  }
+
+  flock(fd, LOCK_UN);
+  close(fd);
+
+  BOOST_LOG_TRIVIAL(debug) << (created ? "created" : "joined") << " outcome table " << path
+                           << " (" << released << " stale claims released)";
+}
+
+
+OutcomeTable::~OutcomeTable() {
+  if (memory)
+    munmap(memory, size);
+}
+
+
+bool OutcomeTable::isOpen() {
+  return outcomes != NULL;
+}
+
+
+uint32_t *OutcomeTable::entry(unsigned testIndex, unsigned long candidateIndex) {
+  return outcomes + (std::size_t) testIndex * numCandidates + candidateIndex;
+}
+
+
+//NOTE: the owner is checked by sending no signal; a process of another user is alive (EPERM)
+bool OutcomeTable::isStaleClaim(uint32_t value) {
+  if ((value & OUTCOME_MASK) != (uint32_t) Outcome::CLAIMED || value == ownClaim)
+    return false;
+  pid_t owner = (pid_t) (value >> OWNER_SHIFT);
+  return kill(owner, 0) == -1 && errno == ESRCH;
+}
+
+
+Outcome OutcomeTable::get(unsigned testIndex, unsigned long candidateIndex) {
+  return (Outcome) (__atomic_load_n(entry(testIndex, candidateIndex), __ATOMIC_ACQUIRE) & OUTCOME_MASK);
+}
+
+
+//NOTE: succeeds if the entry is unknown, already claimed by this worker, or claimed by a terminated one
+bool OutcomeTable::claim(unsigned testIndex, unsigned long candidateIndex) {
+  uint32_t *e = entry(testIndex, candidateIndex);
+  uint32_t current = __atomic_load_n(e, __ATOMIC_ACQUIRE);
+  while (true) {
+    if (current == ownClaim)
+      return true;
+    if (current != (uint32_t) Outcome::UNKNOWN && !isStaleClaim(current))
+      return false;
+    if (__sync_bool_compare_and_swap(e, current, ownClaim)) {
+      if (current != (uint32_t) Outcome::UNKNOWN)
+        BOOST_LOG_TRIVIAL(debug) << "took over claim of terminated worker " << (current >> OWNER_SHIFT);
+      return true;
+    }
+    current = __atomic_load_n(e, __ATOMIC_ACQUIRE);
+  }
+}
+
+
+void OutcomeTable::release(unsigned testIndex, unsigned long candidateIndex) {
+  __sync_bool_compare_and_swap(entry(testIndex, candidateIndex), ownClaim, (uint32_t) Outcome::UNKNOWN);
+}
+
+
+//NOTE: a final outcome replaces an unknown or claimed entry, but is never overwritten
+bool OutcomeTable::publish(unsigned testIndex, unsigned long candidateIndex, Outcome outcome) {
+  uint32_t *e = entry(testIndex, candidateIndex);
+  uint32_t current = __atomic_load_n(e, __ATOMIC_ACQUIRE);
+  while ((current & OUTCOME_MASK) == (uint32_t) Outcome::UNKNOWN ||
+         (current & OUTCOME_MASK) == (uint32_t) Outcome::CLAIMED) {
+    if (__sync_bool_compare_and_swap(e, current, (uint32_t) outcome))
+      return true;
+    current = __atomic_load_n(e, __ATOMIC_ACQUIRE);
+  }
+  return false;
+}
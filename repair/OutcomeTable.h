@@ -0,0 +1,69 @@
+/*
+  This file is part of f1x.
+  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+
+  f1x is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+
+enum class Outcome : unsigned char {
+  UNKNOWN = 0,
+  CLAIMED = 1, // being executed by a worker
+  PASS = 2,
+  FAIL = 3
+};
+
+
+// time between checks of a candidate claimed by another worker, while waiting for its outcome
+const unsigned long CLAIM_POLLING_INTERVAL = 100; // milliseconds
+
+
+/*
+  Test outcomes shared by search workers that explore the same search space. The table is
+  a memory-mapped file indexed by (test, candidate index in generation order), each entry
+  is a word that is claimed and set with atomic compare-and-swap, so no locks are taken after
+  the table is opened. Final outcomes are set only once.
+  NOTE: a claim holds the pid of its owner, so that claims of terminated workers on the same
+  host are taken over; they are also released when the table is opened
+ */
+class OutcomeTable {
+ public:
+  OutcomeTable(const std::string &path, unsigned numTests, unsigned long numCandidates, std::size_t fingerprint);
+  ~OutcomeTable();
+  OutcomeTable(const OutcomeTable&) = delete;
+  OutcomeTable &operator=(const OutcomeTable&) = delete;
+
+  bool isOpen();
+  Outcome get(unsigned testIndex, unsigned long candidateIndex);
+  bool claim(unsigned testIndex, unsigned long candidateIndex);
+  void release(unsigned testIndex, unsigned long candidateIndex);
+  bool publish(unsigned testIndex, unsigned long candidateIndex, Outcome outcome);
+
+ private:
+  unsigned numTests;
+  unsigned long numCandidates;
+  void *memory;
+  std::size_t size;
+  uint32_t *outcomes; // owner pid << 8 | outcome
+  uint32_t ownClaim;
+
+  uint32_t *entry(unsigned testIndex, unsigned long candidateIndex);
+  bool isStaleClaim(uint32_t value);
+};
@@ -59,3 +59,8 @@ double syntacticDiff(const Patch &el) {
   }
   return result;
 }
+
+
+double semanticDiff(const Patch &el, TraceStore &traces) {
+  return traces.distanceToOriginal(el.id);
+}
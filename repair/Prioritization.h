@@ -17,5 +17,8 @@
 */
 
 #include "Core.h"
+#include "TraceStore.h"
 
 double syntacticDiff(const Patch &el);
+
+double semanticDiff(const Patch &el, TraceStore &traces);
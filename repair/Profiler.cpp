@@ -16,6 +16,7 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <string>
 #include <sstream>
 #include <cstdlib>
@@ -59,12 +60,23 @@ unordered_map<Location, vector<unsigned>> Profiler::getRelatedTestIndexes() {
   return relatedTestIndexes;
 }
 
+unordered_map<Location, unordered_map<unsigned, unsigned long>> Profiler::getHitCounts() {
+  return hitCounts;
+}
+
+unordered_map<Location, unordered_map<unsigned, ValueTrace>> Profiler::getValueTraces() {
+  return valueTraces;
+}
+
 bool Profiler::compile() {
   BOOST_LOG_TRIVIAL(debug) << "compiling profile runtime";
   {
     fs::ofstream source(getSource());
     source << "#include <fstream>" << "\n"
-           << "#include <unordered_set>" << "\n"
+           << "#include <sstream>" << "\n"
+           << "#include <string>" << "\n"
+           << "#include <vector>" << "\n"
+           << "#include <unordered_map>" << "\n"
            << "#include \"" << PROFILE_HEADER_FILE_NAME << "\"" << "\n"
            << "struct __f1x_loc {" << "\n"
            << "  unsigned long fileId;" << "\n"
@@ -100,22 +112,57 @@ bool Profiler::compile() {
            << "}" << "\n"
            << "};" << "\n"
            << "}" << "\n"
-           << "std::unordered_set<__f1x_loc> __f1x_locs;" << "\n";
+           << "std::unordered_map<__f1x_loc, unsigned long> __f1x_hits;" << "\n"
+           << "std::unordered_map<__f1x_loc, std::vector<std::string>> __f1x_values_log;" << "\n";
+
+    //NOTE: hit counts and values are written at exit, so they are missing if the program crashes
+    source << "struct __f1x_hits_writer {" << "\n"
+           << "~__f1x_hits_writer() {" << "\n"
+           << "std::ofstream ofs(\""<< (fs::path(cfg.dataDir) / HITS_FILE_NAME).string() << "\", std::ofstream::out | std::ofstream::app);" << "\n"
+           << "for (auto &entry : __f1x_hits) {" << "\n"
+           << "ofs << entry.first.fileId << \" \" << entry.first.beginLine << \" \" << entry.first.beginColumn << \" \""
+           << " << entry.first.endLine << \" \" << entry.first.endColumn << \" \" << entry.second << \"\\n\";" << "\n"
+           << "}" << "\n"
+           << "std::ofstream vfs(\""<< (fs::path(cfg.dataDir) / VALUES_FILE_NAME).string() << "\", std::ofstream::out | std::ofstream::app);" << "\n"
+           << "for (auto &entry : __f1x_values_log) {" << "\n"
+           << "for (unsigned long i = 0; i < entry.second.size(); i++) {" << "\n"
+           << "vfs << entry.first.fileId << \" \" << entry.first.beginLine << \" \" << entry.first.beginColumn << \" \""
+           << " << entry.first.endLine << \" \" << entry.first.endColumn << \" \" << i << \" \" << entry.second[i] << \"\\n\";" << "\n"
+           << "}" << "\n"
+           << "}" << "\n"
+           << "}" << "\n"
+           << "};" << "\n"
+           << "__f1x_hits_writer __f1x_hits_writer_instance;" << "\n";
 
     source << "void __f1x_trace(unsigned long fid, unsigned long bl, unsigned long bc, unsigned long el, unsigned long ec) {"  << "\n"
            << "__f1x_loc loc = {fid, bl, bc, el, ec};" << "\n"
-           << "if (! __f1x_locs.count(loc)) {" << "\n"
+           << "if (__f1x_hits[loc]++ == 0) {" << "\n"
            << "std::ofstream ofs(\""<< (fs::path(cfg.dataDir) / TRACE_FILE_NAME).string() << "\", std::ofstream::out | std::ofstream::app);" << "\n"
            << "ofs << fid << \" \" << bl << \" \" <<  bc << \" \" << el << \" \" << ec << \"\\n\";" << "\n"
-           << "__f1x_locs.insert(loc);" << "\n"
            << "}" << "\n"
            << "}" << "\n";
 
+    source << "void __f1x_values(unsigned long fid, unsigned long bl, unsigned long bc, unsigned long el, unsigned long ec, "
+           << "long long original, unsigned long count, long long *values, char *valid) {" << "\n"
+           << "__f1x_loc loc = {fid, bl, bc, el, ec};" << "\n"
+           << "std::vector<std::string> &log = __f1x_values_log[loc];" << "\n"
+           << "if (log.size() >= " << MAX_RECORDED_HITS << ") return;" << "\n"
+           << "std::ostringstream line;" << "\n"
+           << "line << original << \" \" << count;" << "\n"
+           << "for (unsigned long i = 0; i < count; i++) {" << "\n"
+           << "if (valid[i]) line << \" \" << values[i];" << "\n"
+           << "else line << \" ?\";" << "\n"
+           << "}" << "\n"
+           << "log.push_back(line.str());" << "\n"
+           << "}" << "\n";
+
     fs::ofstream header(getHeader());
     header << "#ifdef __cplusplus" << "\n"
            << "extern \"C\" {" << "\n"
            << "#endif" << "\n";
     header << "void __f1x_trace(unsigned long fid, unsigned long bl, unsigned long bc, unsigned long el, unsigned long ec);\n";
+    header << "void __f1x_values(unsigned long fid, unsigned long bl, unsigned long bc, unsigned long el, unsigned long ec, "
+           << "long long original, unsigned long count, long long *values, char *valid);\n";
     header << "#ifdef __cplusplus" << "\n"
            << "}" << "\n"
            << "#endif" << "\n";
@@ -140,10 +187,39 @@ bool Profiler::compile() {
 }
 
 void Profiler::clearTrace() {
-  fs::path traceFile = fs::path(cfg.dataDir) / TRACE_FILE_NAME;
-  fs::ofstream out;
-  out.open(traceFile, std::ofstream::out | std::ofstream::trunc);
-  out.close();
+  for (auto &name : { TRACE_FILE_NAME, HITS_FILE_NAME, VALUES_FILE_NAME }) {
+    fs::ofstream out;
+    out.open(fs::path(cfg.dataDir) / name, std::ofstream::out | std::ofstream::trunc);
+    out.close();
+  }
+}
+
+//NOTE: traces of each test are kept in the data directory, so that a resumed run can merge them again
+void Profiler::archiveTrace(unsigned testIndex) {
+  fs::path archive = fs::path(cfg.dataDir) / PROFILE_ARCHIVE_DIR_NAME;
+  fs::create_directories(archive);
+  for (auto &name : { TRACE_FILE_NAME, HITS_FILE_NAME, VALUES_FILE_NAME }) {
+    fs::path file = fs::path(cfg.dataDir) / name;
+    fs::path destination = archive / (std::to_string(testIndex) + "_" + name);
+    if (fs::exists(destination))
+      fs::remove(destination);
+    if (fs::exists(file))
+      fs::copy_file(file, destination);
+  }
+}
+
+bool Profiler::restoreTrace(unsigned testIndex) {
+  fs::path archive = fs::path(cfg.dataDir) / PROFILE_ARCHIVE_DIR_NAME;
+  clearTrace();
+  for (auto &name : { TRACE_FILE_NAME, HITS_FILE_NAME, VALUES_FILE_NAME }) {
+    fs::path source = archive / (std::to_string(testIndex) + "_" + name);
+    if (!fs::exists(source))
+      return false;
+    fs::path file = fs::path(cfg.dataDir) / name;
+    fs::remove(file);
+    fs::copy_file(source, file);
+  }
+  return true;
 }
 
 void Profiler::mergeTrace(unsigned testIndex, bool isPassing) {
@@ -174,6 +250,23 @@ void Profiler::mergeTrace(unsigned testIndex, bool isPassing) {
     BOOST_LOG_TRIVIAL(debug) << "test no. " << testIndex << " produces empty trace";
   }
 
+  //NOTE: forked processes write their own counts, so the maximum is taken
+  fs::ifstream hitsFile(fs::path(cfg.dataDir) / HITS_FILE_NAME);
+  if (hitsFile) {
+    string line;
+    while (std::getline(hitsFile, line)) {
+      Location loc;
+      unsigned long hits;
+      std::istringstream iss(line);
+      if (iss >> loc.fileId >> loc.beginLine >> loc.beginColumn >> loc.endLine >> loc.endColumn >> hits) {
+        unsigned long &current = hitCounts[loc][testIndex];
+        current = std::max(current, hits);
+      }
+    }
+  }
+
+  mergeValues(testIndex);
+
   if (!isPassing) {
     if (interestingLocations.empty()) {
       interestingLocations.insert(covered.begin(), covered.end());
@@ -198,6 +291,72 @@ void Profiler::mergeTrace(unsigned testIndex, bool isPassing) {
   }
 }
 
+void Profiler::mergeValues(unsigned testIndex) {
+  fs::ifstream valuesFile(fs::path(cfg.dataDir) / VALUES_FILE_NAME);
+  if (! valuesFile)
+    return;
+
+  //NOTE: forked processes write the hits before fork again, so the same hit can occur several times
+  unordered_map<Location, vector<string>> hits;
+  set<string> inconsistent;
+  string line;
+  while (std::getline(valuesFile, line)) {
+    Location loc;
+    unsigned long index;
+    std::istringstream iss(line);
+    if (! (iss >> loc.fileId >> loc.beginLine >> loc.beginColumn >> loc.endLine >> loc.endColumn >> index))
+      continue;
+    string values;
+    std::getline(iss, values);
+    vector<string> &current = hits[loc];
+    if (index < current.size()) {
+      if (current[index] != values)
+        inconsistent.insert(locToString(loc));
+    } else if (index == current.size()) {
+      current.push_back(values);
+    } else {
+      inconsistent.insert(locToString(loc));
+    }
+  }
+
+  for (auto &entry : hits) {
+    if (inconsistent.count(locToString(entry.first)))
+      continue;
+    auto locationHits = hitCounts.find(entry.first);
+    if (locationHits == hitCounts.end() ||
+        ! locationHits->second.count(testIndex) ||
+        locationHits->second[testIndex] != entry.second.size())
+      continue; // some hits were not recorded
+
+    ValueTrace trace;
+    trace.numComponents = 0;
+    bool wellFormed = true;
+    for (unsigned long i = 0; i < entry.second.size() && wellFormed; i++) {
+      std::istringstream iss(entry.second[i]);
+      long long original;
+      unsigned long numComponents;
+      wellFormed = bool(iss >> original >> numComponents);
+      if (i == 0)
+        trace.numComponents = numComponents;
+      wellFormed = wellFormed && (numComponents == trace.numComponents);
+      trace.original.push_back(original);
+      for (unsigned long c = 0; c < numComponents && wellFormed; c++) {
+        string value;
+        wellFormed = bool(iss >> value);
+        if (value == "?") {
+          trace.values.push_back(0);
+          trace.valid.push_back(false);
+        } else {
+          trace.values.push_back(std::stoll(value));
+          trace.valid.push_back(true);
+        }
+      }
+    }
+    if (wellFormed)
+      valueTraces[entry.first][testIndex] = std::move(trace);
+  }
+}
+
 fs::path Profiler::getProfile() {
   fs::path profileFile = fs::path(cfg.dataDir)/ PROFILE_FILE_NAME;
   fs::ofstream outfile(profileFile, std::ios::app);
@@ -216,5 +375,14 @@ fs::path Profiler::getProfile() {
     outfile << loc << "\n";
   }
 
+  auto vt = valueTraces.begin();
+  while (vt != valueTraces.end()) {
+    if (! relatedTestIndexes.count(vt->first)) {
+      vt = valueTraces.erase(vt);
+    } else {
+      vt++;
+    }
+  }
+
   return profileFile;
 }
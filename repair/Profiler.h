@@ -20,6 +20,7 @@
 
 #include <unordered_map>
 #include <set>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 
@@ -27,9 +28,27 @@
 
 
 const std::string TRACE_FILE_NAME          = "trace.txt";
+const std::string HITS_FILE_NAME           = "hits.txt";
+const std::string VALUES_FILE_NAME         = "values.txt";
 const std::string PROFILE_FILE_NAME        = "profile.txt";
 const std::string PROFILE_SOURCE_FILE_NAME = "profile.cpp";
 const std::string PROFILE_HEADER_FILE_NAME = "profile.h";
+const std::string PROFILE_ARCHIVE_DIR_NAME = "profile";
+
+// number of hits per location for which component values are recorded
+const unsigned long MAX_RECORDED_HITS = 256;
+
+
+/*
+  Values of components and of the original expression at each hit of a location in a single test.
+  Only complete traces (all hits recorded, consistent across forked processes) are kept.
+*/
+struct ValueTrace {
+  unsigned long numComponents;
+  std::vector<long long> original; // per hit
+  std::vector<long long> values;   // numComponents per hit
+  std::vector<bool> valid;         // false if the component could not be safely read
+};
 
 
 class Profiler {
@@ -38,11 +57,19 @@ class Profiler {
   boost::filesystem::path getSource();
   bool compile();
   std::unordered_map<Location, std::vector<unsigned>> getRelatedTestIndexes();
+  std::unordered_map<Location, std::unordered_map<unsigned, unsigned long>> getHitCounts();
+  std::unordered_map<Location, std::unordered_map<unsigned, ValueTrace>> getValueTraces();
   boost::filesystem::path getProfile();
   void mergeTrace(unsigned testIndex, bool isPassing);
   void clearTrace();
+  void archiveTrace(unsigned testIndex);
+  bool restoreTrace(unsigned testIndex);
 
  private:
+  void mergeValues(unsigned testIndex);
+
   std::unordered_map<Location, std::vector<unsigned>> relatedTestIndexes;
+  std::unordered_map<Location, std::unordered_map<unsigned, unsigned long>> hitCounts;
+  std::unordered_map<Location, std::unordered_map<unsigned, ValueTrace>> valueTraces;
   std::set<std::string> interestingLocations; //NOTE: set of string to make more deterministic
 };
@@ -32,6 +32,7 @@
 #include "Project.h"
 #include "Util.h"
 #include "Global.h"
+#include "Runtime.h"
 
 namespace fs = boost::filesystem;
 namespace json = rapidjson;
@@ -117,10 +118,11 @@ void adjustCompileDB() {
       unsigned index = command.find(" ");
       command = command.substr(0, index) + " " + includeCmd + " " + command.substr(index);
     }
-    string defineCmd =  "-D__f1xapp=0ul";
-    if (command.find(defineCmd) == std::string::npos) {
-      unsigned long index = command.find(" ");
-      command = command.substr(0, index) + " " + defineCmd + " " + command.substr(index);
+    for (auto &defineCmd : { "-D__f1xapp=0ul", "-D__f1xshadow=0ul" }) {
+      if (command.find(defineCmd) == std::string::npos) {
+        unsigned long index = command.find(" ");
+        command = command.substr(0, index) + " " + defineCmd + " " + command.substr(index);
+      }
     }
     entry.GetObject()["command"].SetString(command.c_str(), db.GetAllocator());
   }
@@ -138,7 +140,7 @@ Project::Project(const std::vector<ProjectFile> &files,
                  const std::string &buildCmd):
   files(files),
   buildCmd(buildCmd) {
-  saveOriginalFiles();
+  initOriginalFiles();
   patchTemplateDir = fs::path(cfg.dataDir) / "templates";
   fs::create_directory(patchTemplateDir);
   }
@@ -218,12 +220,13 @@ bool Project::build() {
   return success;
 }
 
-bool Project::buildWithRuntime(const fs::path &header) {
+bool Project::buildWithRuntime(const fs::path &header, bool traceCoverage) {
   BOOST_LOG_TRIVIAL(info) << "building project with f1x runtime";
 
   bool success = buildInEnvironment({ {"CC", "f1x-cc"},
                                       {"CXX", "f1x-cxx"},
                                       {"F1X_RUNTIME_H", header.string()},
+                                      {"F1X_RUNTIME_CFLAGS", traceCoverage ? COVERAGE_COMPILER_FLAGS : ""},
                                       {"F1X_RUNTIME_LIB", cfg.dataDir},
                                       {"LD_LIBRARY_PATH", cfg.dataDir} },
                                     buildCmd);
@@ -231,6 +234,19 @@ bool Project::buildWithRuntime(const fs::path &header) {
   return success;
 }
 
+//NOTE: an interrupted run may leave files instrumented or patched, so a resumed run recovers them
+void Project::initOriginalFiles() {
+  bool saved = cfg.resume;
+  for (unsigned long i = 0; i < files.size(); i++) {
+    if (!fs::exists(fs::path(cfg.dataDir) / fs::path("original" + std::to_string(i) + ".c")))
+      saved = false;
+  }
+  if (saved)
+    restoreOriginalFiles();
+  else
+    saveOriginalFiles();
+}
+
 void Project::saveFilesWithPrefix(const string &prefix) {
   for (int i = 0; i < files.size(); i++) {
     auto destination = fs::path(cfg.dataDir) / fs::path(prefix + std::to_string(i) + ".c");
@@ -325,6 +341,8 @@ bool Project::instrumentFile(const ProjectFile &file,
       << " --file-id " << id
       << " --output " + outputFile.string();
   if (cfg.verbose) {
+    if (profile)
+      cmd << " --dump-json " << fs::path(outputFile).replace_extension(".json").string();
     cmd << " >&2";
   } else {
     cmd << " >/dev/null 2>&1";
@@ -409,7 +427,7 @@ vector<fs::path> Project::filesFromCompilationDB() {
 
 void Project::setFiles(const std::vector<ProjectFile> &fs) {
   files = fs;
-  saveOriginalFiles();
+  initOriginalFiles();
 }
 
 
@@ -422,9 +440,14 @@ TestingFramework::TestingFramework(const Project &project,
 
 
 TestStatus TestingFramework::execute(const std::string &testId) {
+  return execute(testId, testTimeout);
+}
+
+
+TestStatus TestingFramework::execute(const std::string &testId, unsigned long timeout) {
   InEnvironment env(map<string, string>{{"LD_LIBRARY_PATH", cfg.dataDir}});
   std::stringstream cmd;
-  cmd << "timeout " << std::setprecision(3) << ((double) testTimeout) / 1000.0 << "s"
+  cmd << "timeout " << std::setprecision(3) << ((double) timeout) / 1000.0 << "s"
       << " " << driver.string() << " " << testId;
   if (cfg.verbose) {
     cmd << " >&2";
@@ -442,6 +465,10 @@ TestStatus TestingFramework::execute(const std::string &testId) {
   }
 }
 
+unsigned long TestingFramework::getTimeout() {
+  return testTimeout;
+}
+
 bool TestingFramework::driverIsOK() {
   if (! fs::exists(driver)) {
     return false;
@@ -42,7 +42,7 @@ class Project {
 
   std::pair<bool, bool> initialBuild();
   bool build();
-  bool buildWithRuntime(const boost::filesystem::path &header);
+  bool buildWithRuntime(const boost::filesystem::path &header, bool traceCoverage = false);
   void saveOriginalFiles();
   void saveInstrumentedFiles();
   void saveProfileInstumentedFiles();
@@ -64,6 +64,7 @@ class Project {
   std::string buildCmd;
   boost::filesystem::path patchTemplateDir;
 
+  void initOriginalFiles();
   void saveFilesWithPrefix(const std::string &prefix);
   void restoreFilesWithPrefix(const std::string &prefix);
   bool buildInEnvironment(const std::map<std::string, std::string> &env, const std::string &baseCmd);
@@ -78,7 +79,9 @@ class TestingFramework {
                    const unsigned long testTimeout);
   
   TestStatus execute(const std::string &testId);
+  TestStatus execute(const std::string &testId, unsigned long timeout);
   bool driverIsOK();
+  unsigned long getTimeout();
 
  private:
   Project project;
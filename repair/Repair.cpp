@@ -25,6 +25,7 @@
 #include <map>
 #include <set>
 #include <vector>
+#include <chrono>
 
 #include <boost/filesystem/fstream.hpp>
 #include <boost/log/trivial.hpp>
@@ -38,8 +39,14 @@
 #include "Profiler.h"
 #include "Synthesis.h"
 #include "SearchEngine.h"
+#include "TestScheduler.h"
+#include "ValueReplay.h"
+#include "Domains.h"
 #include "FaultLocalization.h"
 #include "Prioritization.h"
+#include "Distributed.h"
+#include "Checkpoint.h"
+#include "OutcomeCache.h"
 
 namespace fs = boost::filesystem;
 using std::vector;
@@ -118,13 +125,31 @@ RepairStatus repair(Project &project,
                     const std::vector<std::string> &tests,
                     const boost::filesystem::path &patchOutput) {
 
-  pair<bool, bool> initialBuildStatus = project.initialBuild();
-  if (! initialBuildStatus.first) {
-    BOOST_LOG_TRIVIAL(warning) << "compilation returned non-zero exit code";
+  fs::path checkpointFile = fs::path(cfg.dataDir) / CHECKPOINT_FILE_NAME;
+  Checkpoint checkpoint = emptyCheckpoint(tests);
+  if (cfg.resume) {
+    Checkpoint saved = checkpoint;
+    if (loadCheckpoint(checkpointFile, saved) && saved.profileStatus.size() == tests.size()) {
+      BOOST_LOG_TRIVIAL(info) << "resuming from checkpoint";
+      checkpoint = saved;
+    } else {
+      BOOST_LOG_TRIVIAL(warning) << "no usable checkpoint in " << cfg.dataDir;
+    }
   }
-  if (! initialBuildStatus.second) {
-    BOOST_LOG_TRIVIAL(error) << "failed to infer compile commands";
-    return RepairStatus::ERROR;
+
+  bool profiled = (checkpoint.stage >= CheckpointStage::PROFILED);
+
+  if (profiled && fs::exists("compile_commands.json")) {
+    BOOST_LOG_TRIVIAL(info) << "using compile commands of resumed run";
+  } else {
+    pair<bool, bool> initialBuildStatus = project.initialBuild();
+    if (! initialBuildStatus.first) {
+      BOOST_LOG_TRIVIAL(warning) << "compilation returned non-zero exit code";
+    }
+    if (! initialBuildStatus.second) {
+      BOOST_LOG_TRIVIAL(error) << "failed to infer compile commands";
+      return RepairStatus::ERROR;
+    }
   }
 
   //NOTE: checking here because it can be compiled
@@ -133,7 +158,9 @@ RepairStatus repair(Project &project,
     return RepairStatus::ERROR;
   }
 
-  if (project.getFiles().empty()) {
+  if (profiled) {
+    project.setFiles(checkpoint.files);
+  } else if (project.getFiles().empty()) {
     BOOST_LOG_TRIVIAL(info) << "localizing suspicious files";
     FaultLocalization faultLocal(tests,tester);
     vector<fs::path> allFiles = project.filesFromCompilationDB();
@@ -152,38 +179,61 @@ RepairStatus repair(Project &project,
 
   fs::path traceFile = fs::path(cfg.dataDir) / TRACE_FILE_NAME;
 
-  BOOST_LOG_TRIVIAL(info) << "instrumenting source files for profiling";
-  for (auto &file : project.getFiles()) {
-    bool profileInstSuccess = project.instrumentFile(file, traceFile);
-    if (! profileInstSuccess) {
-      BOOST_LOG_TRIVIAL(warning) << "profiling instrumentation of " << file.relpath << " returned non-zero exit code";
+  Profiler profiler;
+
+  if (!profiled) {
+    BOOST_LOG_TRIVIAL(info) << "instrumenting source files for profiling";
+    for (auto &file : project.getFiles()) {
+      bool profileInstSuccess = project.instrumentFile(file, traceFile);
+      if (! profileInstSuccess) {
+        BOOST_LOG_TRIVIAL(warning) << "profiling instrumentation of " << file.relpath << " returned non-zero exit code";
+      }
     }
-  }
-  project.saveProfileInstumentedFiles();
+    project.saveProfileInstumentedFiles();
 
-  Profiler profiler;
+    bool profilerBuildSuccess = profiler.compile();
+    if (! profilerBuildSuccess) {
+      BOOST_LOG_TRIVIAL(error) << "profiler runtime compilation failed";
+      return RepairStatus::ERROR;
+    }
 
-  bool profilerBuildSuccess = profiler.compile();
-  if (! profilerBuildSuccess) {
-    BOOST_LOG_TRIVIAL(error) << "profiler runtime compilation failed";
-    return RepairStatus::ERROR;
-  }
+    bool profileRebuildSucceeded = project.buildWithRuntime(profiler.getHeader());
+    if (! profileRebuildSucceeded) {
+      BOOST_LOG_TRIVIAL(warning) << "compilation with profiler runtime returned non-zero exit code";
+    }
 
-  bool profileRebuildSucceeded = project.buildWithRuntime(profiler.getHeader());
-  if (! profileRebuildSucceeded) {
-    BOOST_LOG_TRIVIAL(warning) << "compilation with profiler runtime returned non-zero exit code";
+    project.restoreOriginalFiles();
   }
 
-  project.restoreOriginalFiles();
-
-  BOOST_LOG_TRIVIAL(info) << "profiling project";
+  //NOTE: a resumed run merges the archived traces instead of executing tests
+  BOOST_LOG_TRIVIAL(info) << (profiled ? "restoring profile" : "profiling project");
+  TestScheduler scheduler(tests.size(), tester.getTimeout());
   vector<string> negativeTests;
+  vector<bool> originalPassing(tests.size(), false);
   unsigned long numPositive = 0;
   unsigned long numNegative = 0;
   for (int i = 0; i < tests.size(); i++) {
     auto test = tests[i];
-    profiler.clearTrace();
-    TestStatus status = tester.execute(test);
+    TestStatus status;
+    unsigned long time;
+    if (profiled) {
+      status = checkpoint.profileStatus[i];
+      time = checkpoint.profileTime[i];
+      if (!profiler.restoreTrace(i)) {
+        BOOST_LOG_TRIVIAL(warning) << "archived trace of test " << test << " is missing";
+      }
+    } else {
+      profiler.clearTrace();
+      std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+      status = tester.execute(test);
+      std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+      time = std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count();
+      profiler.archiveTrace(i);
+      checkpoint.profileStatus.push_back(status);
+      checkpoint.profileTime.push_back(time);
+    }
+    scheduler.recordProfile(i, status, time);
+    originalPassing[i] = (status == TestStatus::PASS);
     if (status == TestStatus::PASS)
       numPositive++;
     else {
@@ -194,6 +244,12 @@ RepairStatus repair(Project &project,
       BOOST_LOG_TRIVIAL(warning) << "test " << test << " timeout during profiling";
     profiler.mergeTrace(i, (status == TestStatus::PASS));
   }
+
+  if (!profiled) {
+    checkpoint.stage = CheckpointStage::PROFILED;
+    checkpoint.files = project.getFiles();
+    saveCheckpoint(checkpointFile, checkpoint);
+  }
   if (numNegative == 0) {
     BOOST_LOG_TRIVIAL(error) << "no negative tests";
     return RepairStatus::NO_NEGATIVE_TESTS;
@@ -203,9 +259,6 @@ RepairStatus repair(Project &project,
   BOOST_LOG_TRIVIAL(info) << "number of negative tests: " << numNegative;
   BOOST_LOG_TRIVIAL(info) << "negative tests: " << prettyPrintTests(negativeTests);
 
-  if (cfg.patchPrioritization == PatchPrioritization::SEMANTIC_DIFF)
-    project.deleteCoverageFiles();
- 
   fs::path profile = profiler.getProfile();
 
   auto relatedTestIndexes = profiler.getRelatedTestIndexes();
@@ -213,15 +266,21 @@ RepairStatus repair(Project &project,
   
   vector<fs::path> saFiles;
 
-  BOOST_LOG_TRIVIAL(info) << "applying transfomation schemas to source files";
+  bool transformed = (checkpoint.stage >= CheckpointStage::TRANSFORMED);
+
+  if (!transformed) {
+    BOOST_LOG_TRIVIAL(info) << "applying transfomation schemas to source files";
+  }
   for (int i=0; i<project.getFiles().size(); i++) {
     std::stringstream schemaAppFile;
-    schemaAppFile << APPLICATIONS_FILE_PREFIX << i << ".json";
+    schemaAppFile << APPLICATIONS_FILE_PREFIX << i << ".bin";
     fs::path saFile = fs::path(cfg.dataDir) / schemaAppFile.str();
     saFiles.push_back(saFile);
-    bool instrSuccess = project.instrumentFile(project.getFiles()[i], saFile, &profile);
-    if (! instrSuccess) {
-      BOOST_LOG_TRIVIAL(warning) << "transformation returned non-zero exit code";
+    if (!transformed) {
+      bool instrSuccess = project.instrumentFile(project.getFiles()[i], saFile, &profile);
+      if (! instrSuccess) {
+        BOOST_LOG_TRIVIAL(warning) << "transformation returned non-zero exit code";
+      }
     }
     if (! fs::exists(saFile)) {
       BOOST_LOG_TRIVIAL(error) << "failed to extract candidate locations";
@@ -229,19 +288,31 @@ RepairStatus repair(Project &project,
     }
   }
 
-  project.saveInstrumentedFiles();
+  if (transformed) {
+    project.restoreInstrumentedFiles();
+  } else {
+    project.saveInstrumentedFiles();
+    checkpoint.stage = CheckpointStage::TRANSFORMED;
+    saveCheckpoint(checkpointFile, checkpoint);
+  }
 
   BOOST_LOG_TRIVIAL(debug) << "loading candidate locations";
   vector<shared_ptr<SchemaApplication>> sas = loadSchemaApplications(saFiles);
   
   BOOST_LOG_TRIVIAL(debug) << "inferring types";
-  for (auto sa : sas) {
-    Type context;
-    if (sa->context == LocationContext::CONDITION)
-      context = Type::BOOLEAN;
-    else
-      context = Type::ANY;
-    sa->original = correctTypes(sa->original, context);
+  parallelFor(sas.size(), [&](unsigned long i) {
+      auto sa = sas[i];
+      Type context;
+      if (sa->context == LocationContext::CONDITION)
+        context = Type::BOOLEAN;
+      else
+        context = Type::ANY;
+      sa->original = correctTypes(sa->original, context);
+    });
+
+  if (cfg.valueDomains) {
+    BOOST_LOG_TRIVIAL(debug) << "inferring synthesis domains";
+    inferDomains(sas, profiler.getValueTraces(), relatedTestIndexes);
   }
 
   vector<Patch> searchSpace;
@@ -249,22 +320,71 @@ RepairStatus repair(Project &project,
   Runtime runtime;
 
   BOOST_LOG_TRIVIAL(info) << "generating search space";
+  unordered_map<AppID, unsigned long> duplicates;
   {
     fs::ofstream os(runtime.getSource());
     fs::ofstream oh(runtime.getHeader());
-    searchSpace = generateSearchSpace(sas, os, oh);
+    searchSpace = generateSearchSpace(sas, os, oh, duplicates);
+  }
+  unsigned long numDuplicates = 0;
+  for (auto sa : sas) {
+    if (duplicates[sa->id] == 0)
+      continue;
+    BOOST_LOG_TRIVIAL(debug) << "equivalent candidates removed at location " << sa->id << ": " << duplicates[sa->id];
+    numDuplicates += duplicates[sa->id];
   }
+  BOOST_LOG_TRIVIAL(info) << "equivalent candidates removed: " << numDuplicates;
 
   BOOST_LOG_TRIVIAL(info) << "search space size: " << searchSpace.size();
 
-  bool runtimeSuccess = runtime.compile();
+  //NOTE: the runtime identifies candidates in shadow mode by their position in the generated search space
+  // the same order also indexes the shared outcome table, which is checked with a fingerprint
+  unordered_map<PatchID, unsigned long> shadowIndexes;
+  std::size_t searchSpaceFingerprint = 0;
+  for (unsigned long i = 0; i < searchSpace.size(); i++) {
+    shadowIndexes[searchSpace[i].id] = i;
+    hash_combine(searchSpaceFingerprint, searchSpace[i].id);
+  }
+
+  //NOTE: the runtime of a resumed run is reused if the generated code is the same
+  std::size_t runtimeHash = 0;
+  for (auto &file : { runtime.getSource(), runtime.getHeader() }) {
+    fs::ifstream in(file);
+    std::stringstream content;
+    content << in.rdbuf();
+    hash_combine(runtimeHash, content.str());
+  }
+  bool compiled = (checkpoint.stage >= CheckpointStage::COMPILED &&
+                   checkpoint.runtimeHash == runtimeHash &&
+                   fs::exists(runtime.getLibrary()));
+
+  bool runtimeSuccess = compiled || runtime.compile();
 
   if (! runtimeSuccess) {
     BOOST_LOG_TRIVIAL(error) << "runtime compilation failed";
     return RepairStatus::ERROR;
   }
 
-  bool rebuildSucceeded = project.buildWithRuntime(runtime.getHeader());
+  //NOTE: cached outcomes are valid for the same instrumented sources and runtime
+  std::size_t programHash = runtimeHash;
+  for (auto &file : project.getFiles()) {
+    fs::ifstream in(file.relpath);
+    std::stringstream content;
+    content << in.rdbuf();
+    hash_combine(programHash, file.relpath.string());
+    hash_combine(programHash, content.str());
+  }
+
+  if (!compiled) {
+    if (checkpoint.stage < CheckpointStage::COMPILED || checkpoint.runtimeHash != runtimeHash)
+      checkpoint.stage = CheckpointStage::COMPILED;
+    checkpoint.runtimeHash = runtimeHash;
+    saveCheckpoint(checkpointFile, checkpoint);
+  }
+
+  bool traceCoverage = (cfg.patchPrioritization == PatchPrioritization::SEMANTIC_DIFF);
+
+  bool rebuildSucceeded = project.buildWithRuntime(runtime.getHeader(), traceCoverage);
 
   if (! rebuildSucceeded) {
     BOOST_LOG_TRIVIAL(warning) << "compilation with runtime returned non-zero exit code";
@@ -289,18 +409,185 @@ RepairStatus repair(Project &project,
     dumpSearchSpace(searchSpace, path, filePaths, cost);
   }
 
-  SearchEngine engine(tests, tester, runtime, getPartitionable(searchSpace), relatedTestIndexes);
+  SearchEngine engine(tests, tester, runtime, getPartitionable(searchSpace), relatedTestIndexes, profiler.getHitCounts(), scheduler);
+
+  //NOTE: outcomes are shared only by workers that search in the same program with the same runtime
+  if (!cfg.outcomeTable.empty()) {
+    hash_combine(searchSpaceFingerprint, programHash);
+    for (auto &test : tests)
+      hash_combine(searchSpaceFingerprint, test);
+    auto table = std::make_shared<OutcomeTable>(cfg.outcomeTable, tests.size(),
+                                                shadowIndexes.size(), searchSpaceFingerprint);
+    if (table->isOpen()) {
+      engine.shareOutcomes(table, shadowIndexes);
+    } else {
+      BOOST_LOG_TRIVIAL(warning) << "searching without shared outcome table";
+    }
+  }
+
+  if (!cfg.outcomeCache.empty()) {
+    auto cache = std::make_shared<OutcomeCache>(cfg.outcomeCache);
+    if (cache->isOpen()) {
+      BOOST_LOG_TRIVIAL(info) << "outcome cache entries: " << cache->getSize();
+      unordered_map<PatchID, std::size_t> cacheKeys;
+      for (auto &patch : searchSpace) {
+        std::size_t key = programHash;
+        hash_combine(key, patch.app->location);
+        hash_combine(key, (unsigned) patch.app->schema);
+        hash_combine(key, visualizeChange(patch));
+        hash_combine(key, tester.getTimeout());
+        cacheKeys[patch.id] = key;
+      }
+      engine.cacheOutcomes(cache, cacheKeys);
+    } else {
+      BOOST_LOG_TRIVIAL(warning) << "searching without outcome cache";
+    }
+  }
+
+  //NOTE: distributed processes identify candidates by their position in the prioritized search space
+  std::unique_ptr<SearchCoordinator> coordinator;
+  std::unique_ptr<SearchWorker> worker;
+  unordered_map<PatchID, unsigned long> searchIndexes;
+  if (cfg.coordinatorPort || !cfg.coordinatorAddress.empty()) {
+    std::size_t fingerprint = 0;
+    for (unsigned long i = 0; i < searchSpace.size(); i++) {
+      searchIndexes[searchSpace[i].id] = i;
+      hash_combine(fingerprint, searchSpace[i].id);
+    }
+    for (auto &test : tests)
+      hash_combine(fingerprint, test);
+
+    if (cfg.coordinatorPort) {
+      coordinator.reset(new SearchCoordinator(cfg.coordinatorPort, searchSpace.size(), fingerprint));
+      if (!coordinator->start())
+        return RepairStatus::ERROR;
+    } else {
+      auto learn = [&](unsigned testIndex, unsigned long index, bool passed) {
+        engine.addOutcome(testIndex, searchSpace[index].id, passed);
+      };
+      worker.reset(new SearchWorker(cfg.coordinatorAddress, searchSpace.size(), fingerprint, learn));
+      if (!worker->connect())
+        return RepairStatus::ERROR;
+      engine.onOutcome([&](unsigned testIndex, const PatchID &id, bool passed) {
+          auto index = searchIndexes.find(id);
+          if (index != searchIndexes.end())
+            worker->record(testIndex, index->second, passed);
+        });
+    }
+  }
+
+  if ((cfg.patchPrioritization == PatchPrioritization::SEMANTIC_DIFF || cfg.adaptiveTimeout) && !coordinator)
+    engine.runOriginal();
+
+  //NOTE: distributed runs checkpoint only the stages before the search
+  bool distributed = (coordinator || worker);
+  bool searching = (!distributed &&
+                    checkpoint.stage == CheckpointStage::SEARCHING &&
+                    checkpoint.searchIndex <= searchSpace.size());
 
   unsigned long last = 0;
   unordered_set<AppID> fixLocations;
   unordered_set<AppID> moreThanOneFound;
 
   vector<Patch> plausiblePatches;
+  vector<unsigned long> plausibleIndexes;
+  bool finished = false;
+
+  if (searching) {
+    BOOST_LOG_TRIVIAL(info) << "resuming search from candidate " << checkpoint.searchIndex;
+    engine.importState(checkpoint.search);
+    last = checkpoint.searchIndex;
+    for (auto index : checkpoint.plausible) {
+      if (index >= searchSpace.size())
+        continue;
+      Patch patch = searchSpace[index];
+      if (fixLocations.count(patch.app->id))
+        moreThanOneFound.insert(patch.app->id);
+      fixLocations.insert(patch.app->id);
+      plausiblePatches.push_back(patch);
+      plausibleIndexes.push_back(index);
+    }
+    if (! cfg.generateAll && ! plausiblePatches.empty())
+      finished = true;
+  }
+
+  ValueReplay replay(profiler.getValueTraces());
+
+  //NOTE: the coordinator does not execute tests, so it skips the analyses that prune its own search
+  if (cfg.valueReplay && !coordinator && !searching) {
+    engine.replayValues(searchSpace, replay, originalPassing);
+  }
+
+  if (cfg.shadowEvaluation && !coordinator && !searching) {
+    engine.shadowEvaluate(searchSpace, shadowIndexes, originalPassing);
+  }
+
+  if (cfg.angelicSearch && !coordinator && !searching) {
+    engine.angelicSearch(searchSpace, replay, originalPassing);
+  }
+
+  auto saveSearch = [&](unsigned long index) {
+    checkpoint.stage = CheckpointStage::SEARCHING;
+    checkpoint.searchIndex = index;
+    checkpoint.plausible = plausibleIndexes;
+    checkpoint.search = engine.exportState();
+    saveCheckpoint(checkpointFile, checkpoint);
+  };
+
+  //NOTE: outcomes are journaled as they are recorded, and compacted into the checkpoint periodically
+  std::unique_ptr<CheckpointJournal> journal;
+  std::chrono::steady_clock::time_point lastSave = std::chrono::steady_clock::now();
+  if (!distributed) {
+    saveSearch(last);
+    journal.reset(new CheckpointJournal(checkpointFile));
+    engine.onOutcome([&](unsigned testIndex, const PatchID &id, bool passed) {
+        journal->recordOutcome(testIndex, id, passed);
+        unsigned distance;
+        if (passed && engine.getTraces().getDistance(testIndex, id, distance))
+          journal->recordDistance(testIndex, id, distance);
+      });
+    engine.onProgress([&](unsigned long index) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now - lastSave >= CHECKPOINT_INTERVAL) {
+          saveSearch(std::max(index, last));
+          lastSave = now;
+        }
+      });
+  }
 
   // generate plausible patches
-  while (last < searchSpace.size()) {
-    last = engine.findNext(searchSpace, last);
-    if (last == searchSpace.size())
+  //NOTE: candidates claimed by other workers are retried after the search space is explored;
+  // distributed workers retry them immediately, since their candidates are assigned one by one
+  while (!finished) {
+    unsigned long found;
+    if (coordinator) {
+      found = coordinator->findNext();
+      if (found < searchSpace.size()) {
+        for (auto &distance : coordinator->getDistances(found))
+          engine.getTraces().setDistance(distance.first, searchSpace[found].id, distance.second);
+      }
+    } else if (worker) {
+      found = worker->findNext([&](unsigned long index) {
+          bool plausible = engine.findNext(searchSpace, index, index + 1) == index ||
+            engine.findDeferred(searchSpace) == index;
+          //NOTE: the coordinator ranks plausible patches with the distances computed by workers
+          if (plausible && cfg.patchPrioritization == PatchPrioritization::SEMANTIC_DIFF) {
+            for (unsigned test = 0; test < tests.size(); test++) {
+              unsigned distance;
+              if (engine.getTraces().getDistance(test, searchSpace[index].id, distance))
+                worker->recordDistance(test, index, distance);
+            }
+          }
+          return plausible;
+        });
+    } else {
+      if (last < searchSpace.size())
+        last = engine.findNext(searchSpace, last);
+      found = last;
+      if (found == searchSpace.size())
+        found = engine.findDeferred(searchSpace);
+    }
+    if (found == searchSpace.size())
       break;
 
     if (cfg.outputTop && plausiblePatches.size() >= cfg.outputTop) {
@@ -308,7 +595,7 @@ RepairStatus repair(Project &project,
       break;
     }
 
-    Patch patch = searchSpace[last];
+    Patch patch = searchSpace[found];
 
     if (!moreThanOneFound.count(patch.app->id) || cfg.verbose) {
       fs::path relpath = project.getFiles()[patch.app->location.fileId].relpath;
@@ -330,19 +617,28 @@ RepairStatus repair(Project &project,
       if (valid) {
         fixLocations.insert(patch.app->id);
         plausiblePatches.push_back(patch);
+        plausibleIndexes.push_back(found);
         break;
       } else {
         project.restoreInstrumentedFiles();
-        project.buildWithRuntime(runtime.getHeader());
+        project.buildWithRuntime(runtime.getHeader(), traceCoverage);
       }
     } else {
       if (fixLocations.count(patch.app->id))
         moreThanOneFound.insert(patch.app->id);
       fixLocations.insert(patch.app->id);
       plausiblePatches.push_back(patch);
+      plausibleIndexes.push_back(found);
     }
 
-    last++;
+    if (found == last)
+      last++;
+  }
+
+  if (!distributed) {
+    engine.onOutcome(nullptr);
+    engine.onProgress(nullptr);
+    saveSearch(last);
   }
 
   // validate patches if needed
@@ -357,21 +653,19 @@ RepairStatus repair(Project &project,
   }
 
   if (cfg.patchPrioritization == PatchPrioritization::SEMANTIC_DIFF) {
-    auto coverageSet = engine.getCoverageSet();
-    for (auto &testCoverage : coverageSet) {
-      BOOST_LOG_TRIVIAL(info) << "test: " << testCoverage.first;
-      std::unordered_map<PatchID, std::shared_ptr<Coverage>> patchCoverage = testCoverage.second;
-      for (auto &patch : plausiblePatches) {
-        BOOST_LOG_TRIVIAL(info) << "patch: " << visualizePatchID(patch.id);
-        Coverage coverage = *patchCoverage[patch.id];
-        for (auto &entry : coverage) {
-          BOOST_LOG_TRIVIAL(info) << "file: " << entry.first;
-          for (auto &line : entry.second) {
-            BOOST_LOG_TRIVIAL(info) << "line: " << line;
-          }
-        }
-      }
+    TraceStore &traces = engine.getTraces();
+    BOOST_LOG_TRIVIAL(info) << "distinct execution traces: " << traces.size();
+    unordered_map<PatchID, double> semanticCost;
+    for (auto &patch : plausiblePatches) {
+      semanticCost[patch.id] = semanticDiff(patch, traces);
+      BOOST_LOG_TRIVIAL(debug) << "semantic distance of " << visualizePatchID(patch.id)
+                               << ": " << semanticCost[patch.id];
     }
+    //NOTE: stable sort keeps syntactic order for patches with equal semantic distance
+    std::stable_sort(plausiblePatches.begin(), plausiblePatches.end(),
+                     [&](const Patch &a, const Patch &b) {
+                       return semanticCost[a.id] < semanticCost[b.id];
+                     });
   }
 
   if (plausiblePatches.size() > 0) {
@@ -404,6 +698,47 @@ RepairStatus repair(Project &project,
   BOOST_LOG_TRIVIAL(info) << "candidates evaluated: " << stat.explorationCounter;
   BOOST_LOG_TRIVIAL(info) << "tests executed: " << stat.executionCounter;
   BOOST_LOG_TRIVIAL(info) << "executions with timeout: " << stat.timeoutCounter;
+  BOOST_LOG_TRIVIAL(info) << "executions terminated by watchdog: " << stat.watchdogCounter;
+  if (cfg.valueReplay) {
+    BOOST_LOG_TRIVIAL(info) << "candidates rejected by value replay: " << stat.replayRejectedCounter;
+    BOOST_LOG_TRIVIAL(info) << "test outcomes inferred by value replay: " << stat.replayInferredCounter;
+  }
+  if (cfg.shadowEvaluation) {
+    BOOST_LOG_TRIVIAL(info) << "executions in shadow mode: " << stat.shadowExecutionCounter;
+    BOOST_LOG_TRIVIAL(info) << "candidates rejected by shadow evaluation: " << stat.shadowRejectedCounter;
+    BOOST_LOG_TRIVIAL(info) << "test outcomes inferred by shadow evaluation: " << stat.shadowInferredCounter;
+  }
+  if (cfg.angelicSearch) {
+    BOOST_LOG_TRIVIAL(info) << "executions with forced condition values: " << stat.angelicExecutionCounter;
+    BOOST_LOG_TRIVIAL(info) << "candidates rejected by angelic value search: " << stat.angelicRejectedCounter;
+  }
+  if (cfg.valueTEQ) {
+    BOOST_LOG_TRIVIAL(info) << "test outcomes inferred by value-based partitioning: " << stat.partitionInferredCounter;
+    BOOST_LOG_TRIVIAL(info) << "locations with partitioning in warmup/enabled/sampled/disabled: "
+                            << stat.partitioningWarmupCounter << "/"
+                            << stat.partitioningEnabledCounter << "/"
+                            << stat.partitioningSampledCounter << "/"
+                            << stat.partitioningDisabledCounter;
+  }
+  if (cfg.dependencyTEQ) {
+    BOOST_LOG_TRIVIAL(info) << "test outcomes inferred by dependency analysis: " << stat.dependencyInferredCounter;
+  }
+  if (!cfg.outcomeTable.empty()) {
+    BOOST_LOG_TRIVIAL(info) << "test outcomes read from shared table: " << stat.sharedInferredCounter;
+    BOOST_LOG_TRIVIAL(info) << "candidates left to other workers: " << stat.sharedSkippedCounter;
+    BOOST_LOG_TRIVIAL(info) << "deferred candidates retried: " << stat.retriedCounter;
+  }
+  if (!cfg.outcomeCache.empty()) {
+    BOOST_LOG_TRIVIAL(info) << "test outcomes read from outcome cache: " << stat.cacheHitCounter;
+    BOOST_LOG_TRIVIAL(info) << "test outcomes added to outcome cache: " << stat.cacheStoredCounter;
+  }
+  if (stat.adaptiveTimeoutCounter != 0) {
+    BOOST_LOG_TRIVIAL(info) << "executions with adaptive timeout: " << stat.adaptiveTimeoutCounter;
+    BOOST_LOG_TRIVIAL(info) << "adaptive timeouts confirmed with global timeout: " << stat.confirmationCounter;
+    //NOTE: a confirmation loses both the time saved by the adaptive timeout and the time spent on it
+    BOOST_LOG_TRIVIAL(info) << "time saved by adaptive timeouts: " << std::setprecision(3)
+                            << ((double) stat.savedTestTime - (double) stat.confirmationTestTime) / 1000.0 << " sec";
+  }
   if (stat.nonTimeoutTestTime != 0) {
     double executionsPerSec = (stat.nonTimeoutCounter * 1000.0) / stat.nonTimeoutTestTime;
     BOOST_LOG_TRIVIAL(info) << "execution speed: " << std::setprecision(3) << executionsPerSec << " exe/sec";
@@ -17,11 +17,13 @@
 */
 
 #include <cstdlib>
+#include <cstring>
 #include <sstream>
 #include <string>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <signal.h>
 
 // for shared memory:
 #include <fcntl.h>
@@ -40,45 +42,216 @@ using std::vector;
 using std::unordered_set;
 
 
-Runtime::Runtime() {
-  std::stringstream realPartitionFileName;
-  size_t size = sizeof(PatchID) * MAX_PARTITION_SIZE;
-  realPartitionFileName << PARTITION_FILE_NAME << "_" << geteuid();
-  int fd = shm_open(realPartitionFileName.str().c_str(), O_CREAT | O_RDWR,
+//NOTE: the data directory exists when segments are named, so its canonical path identifies the run
+std::string sharedMemoryName(const std::string &name) {
+  boost::system::error_code error;
+  fs::path dataDir = fs::canonical(cfg.dataDir, error);
+  if (error)
+    dataDir = fs::absolute(cfg.dataDir);
+  std::size_t run = 0;
+  hash_combine(run, dataDir.string());
+  std::stringstream result;
+  result << name << "_" << geteuid() << "_" << std::hex << run;
+  return result.str();
+}
+
+
+//NOTE: names of mapped segments are kept in static storage, since they are unlinked in signal handlers
+const unsigned MAX_SEGMENTS = 16;
+const unsigned MAX_SEGMENT_NAME_LENGTH = 128;
+static char segmentNames[MAX_SEGMENTS][MAX_SEGMENT_NAME_LENGTH];
+static volatile sig_atomic_t segmentCount = 0;
+static pid_t segmentOwner = 0;
+
+// forked children (e.g. when exec fails) must not unlink the segments of the parent
+static void unlinkSegments() {
+  if (getpid() != segmentOwner)
+    return;
+  for (int i = 0; i < segmentCount; i++)
+    shm_unlink(segmentNames[i]);
+  segmentCount = 0;
+}
+
+static void handleTermination(int sig) {
+  unlinkSegments();
+  signal(sig, SIG_DFL);
+  raise(sig);
+}
+
+static void registerSegment(const std::string &name) {
+  if (segmentOwner == 0) {
+    segmentOwner = getpid();
+    atexit(unlinkSegments);
+    struct sigaction sa;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sa.sa_handler = handleTermination;
+    for (int sig : { SIGHUP, SIGINT, SIGQUIT, SIGABRT, SIGTERM })
+      sigaction(sig, &sa, NULL);
+  }
+  if (segmentCount >= (sig_atomic_t) MAX_SEGMENTS || name.size() >= MAX_SEGMENT_NAME_LENGTH) {
+    BOOST_LOG_TRIVIAL(warning) << "shared memory " << name << " is not unlinked on termination";
+    return;
+  }
+  strcpy(segmentNames[segmentCount], name.c_str());
+  segmentCount++;
+}
+
+void *Runtime::mapSharedMemory(const std::string &name, size_t size) {
+  std::string realFileName = sharedMemoryName(name);
+  int fd = shm_open(realFileName.c_str(), O_CREAT | O_RDWR,
                     S_IRUSR | S_IWUSR);
+  if (fd == -1) {
+    BOOST_LOG_TRIVIAL(error) << "failed to open shared memory " << realFileName;
+    return NULL;
+  }
   ftruncate(fd, size);
-  partition = (PatchID*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED , fd, 0);
+  void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED , fd, 0);
   close(fd);
-  };
-
-void Runtime::setPartition(std::unordered_set<PatchID> ids) {
-  assert(ids.size() < MAX_PARTITION_SIZE);
-  unsigned long index = 0;
-  for (auto &id : ids) {
-    partition[index] = id;
-    index++;
+  if (memory == MAP_FAILED) {
+    BOOST_LOG_TRIVIAL(error) << "failed to map shared memory " << realFileName;
+    shm_unlink(realFileName.c_str());
+    return NULL;
+  }
+  segments.push_back(Segment{realFileName, memory, size});
+  registerSegment(realFileName);
+  return memory;
+}
+
+Runtime::Runtime() {
+  //NOTE: slot indexes are only touched up to the partition size, so most of the segment is never allocated
+  partitionHeader = (PartitionHeader*) mapSharedMemory(PARTITION_FILE_NAME,
+                                                       sizeof(PartitionHeader) +
+                                                       sizeof(PatchID) * MAX_PARTITION_SIZE +
+                                                       sizeof(PartitionSlot) * MAX_PARTITION_SLOTS +
+                                                       sizeof(unsigned) * MAX_PARTITION_SLOTS * MAX_PARTITION_SIZE);
+  partition = (PatchID*) (partitionHeader + 1);
+  partitionSlots = (PartitionSlot*) (partition + MAX_PARTITION_SIZE);
+  partitionIndexes = (unsigned*) (partitionSlots + MAX_PARTITION_SLOTS);
+  coverage = (unsigned char*) mapSharedMemory(COVERAGE_FILE_NAME, COVERAGE_MAP_SIZE);
+  shadow = (unsigned char*) mapSharedMemory(SHADOW_FILE_NAME, MAX_SHADOW_SIZE);
+  angelic = (unsigned char*) mapSharedMemory(ANGELIC_FILE_NAME, sizeof(unsigned long) + MAX_ANGELIC_HITS);
+  dependencies = (unsigned long*) mapSharedMemory(DEPENDENCY_FILE_NAME, sizeof(unsigned long));
+}
+
+Runtime::~Runtime() {
+  for (auto &segment : segments) {
+    munmap(segment.memory, segment.size);
+    shm_unlink(segment.name.c_str());
   }
-  partition[index] = INPUT_TERMINATOR;
 }
 
-unordered_set<PatchID> Runtime::getPartition() {
-  unordered_set<PatchID> result;
-  unsigned long index = 0;
-  while (!(partition[index] == OUTPUT_TERMINATOR)) {
-    if (partition[index] == INPUT_TERMINATOR) {
-      BOOST_LOG_TRIVIAL(debug) << "wrongly terminated partition";
-      return unordered_set<PatchID>();
+void Runtime::setPartition(const vector<PatchID> &ids) {
+  assert(ids.size() <= MAX_PARTITION_SIZE);
+  std::copy(ids.begin(), ids.end(), partition);
+  partitionHeader->count = ids.size();
+  partitionHeader->slots = 0;
+  partitionHeader->overflow = 0;
+  std::fill(partitionSlots, partitionSlots + MAX_PARTITION_SLOTS, PartitionSlot{0, 0, 0});
+}
+
+//NOTE: if the location was not hit, all candidates are equivalent to the active one;
+// a candidate is equivalent only if it agreed in every thread that hit the location
+bool Runtime::getPartition(unordered_set<PatchID> &ids) {
+  ids.clear();
+  unsigned long count = partitionHeader->count;
+  if (partitionHeader->overflow) {
+    BOOST_LOG_TRIVIAL(debug) << "partition slots exhausted";
+    return false;
+  }
+  if (count > MAX_PARTITION_SIZE || partitionHeader->slots > MAX_PARTITION_SLOTS) {
+    BOOST_LOG_TRIVIAL(debug) << "invalid partition";
+    return false;
+  }
+
+  vector<unsigned> agreed(count, 0);
+  unsigned used = 0;
+  for (unsigned long slot = 0; slot < partitionHeader->slots; slot++) {
+    const PartitionSlot &header = partitionSlots[slot];
+    if (header.busy) {
+      BOOST_LOG_TRIVIAL(debug) << "partition refinement was interrupted";
+      return false;
+    }
+    //NOTE: the thread claimed the slot but did not evaluate any candidate
+    if (header.hits == 0)
+      continue;
+    if (header.count > count) {
+      BOOST_LOG_TRIVIAL(debug) << "invalid partition slot";
+      return false;
     }
-    if (index > MAX_PARTITION_SIZE) {
-      BOOST_LOG_TRIVIAL(debug) << "unterminated partition";
-      return unordered_set<PatchID>();
+    used++;
+    const unsigned *indexes = partitionIndexes + slot * count;
+    for (unsigned long i = 0; i < header.count; i++) {
+      if (indexes[i] < count)
+        agreed[indexes[i]]++;
     }
-    result.insert(partition[index]);
-    index++;
+  }
+
+  for (unsigned long i = 0; i < count; i++) {
+    if (agreed[i] == used)
+      ids.insert(partition[i]);
+  }
+  return true;
+}
+
+void Runtime::clearCoverage() {
+  std::memset(coverage, 0, COVERAGE_MAP_SIZE);
+}
+
+CoverageBitmap Runtime::getCoverage() {
+  const unsigned long bitsPerWord = 8 * sizeof(unsigned long);
+  CoverageBitmap result(COVERAGE_MAP_SIZE / bitsPerWord, 0);
+  for (unsigned long edge = 0; edge < COVERAGE_MAP_SIZE; edge++) {
+    if (coverage[edge])
+      result[edge / bitsPerWord] |= 1ul << (edge % bitsPerWord);
   }
   return result;
 }
 
+void Runtime::clearWatchdog() {
+  fs::path watchdogFile = fs::path(cfg.dataDir) / WATCHDOG_FILE_NAME;
+  if (fs::exists(watchdogFile))
+    fs::remove(watchdogFile);
+}
+
+//NOTE: the runtime creates this file before exiting, since the test driver may hide the exit code
+bool Runtime::watchdogTriggered() {
+  return fs::exists(fs::path(cfg.dataDir) / WATCHDOG_FILE_NAME);
+}
+
+void Runtime::clearShadow(unsigned long size) {
+  assert(size <= MAX_SHADOW_SIZE);
+  std::memset(shadow, 0, size);
+}
+
+bool Runtime::diverged(unsigned long index) {
+  return shadow[index] != 0;
+}
+
+void Runtime::clearAngelic() {
+  std::memset(angelic, 0, sizeof(unsigned long));
+}
+
+//NOTE: returns false if the location was hit more times than can be recorded
+bool Runtime::getAngelicValues(vector<bool> &values) {
+  unsigned long hits = *((unsigned long*) angelic);
+  values.clear();
+  if (hits > MAX_ANGELIC_HITS)
+    return false;
+  for (unsigned long hit = 0; hit < hits; hit++) {
+    values.push_back(angelic[sizeof(unsigned long) + hit] != 0);
+  }
+  return true;
+}
+
+void Runtime::clearDependencies() {
+  *dependencies = 0;
+}
+
+unsigned long Runtime::getDependencies() {
+  return *dependencies;
+}
+
 boost::filesystem::path Runtime::getHeader() {
 return fs::path(cfg.dataDir) / RUNTIME_HEADER_FILE_NAME;
 }
@@ -87,6 +260,10 @@ boost::filesystem::path Runtime::getSource() {
 return fs::path(cfg.dataDir) / RUNTIME_SOURCE_FILE_NAME;
 }
 
+boost::filesystem::path Runtime::getLibrary() {
+return fs::path(cfg.dataDir) / RUNTIME_LIBRARY_FILE_NAME;
+}
+
 // FIXME: this should probably be built using F1X_PROJECT_CC instead of hard-coded compiler
 bool Runtime::compile() {
   BOOST_LOG_TRIVIAL(info) << "compiling analysis runtime";
@@ -105,7 +282,7 @@ bool Runtime::compile() {
       << " -shared"
       << " -lrt" // this is for shared memory
       << " -std=c++11" // this is for initializers
-      << " -o libf1xrt.so";
+      << " -o " << RUNTIME_LIBRARY_FILE_NAME;
   if (cfg.verbose) {
     cmd << " >&2";
   } else {
@@ -21,6 +21,7 @@
 #include <unordered_set>
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 
@@ -30,22 +31,104 @@
 
 const std::string RUNTIME_SOURCE_FILE_NAME = "rt.cpp";
 const std::string RUNTIME_HEADER_FILE_NAME = "rt.h";
+const std::string RUNTIME_LIBRARY_FILE_NAME = "libf1xrt.so";
 
+// the partition segment is a header, candidate ids, slot headers and slot indexes; each thread
+// (and each forked process) of the program claims its own slot, in which it keeps the indexes of
+// the candidates that agreed with the active one on all its hits; the engine intersects the slots
 const unsigned long MAX_PARTITION_SIZE = 1000000;
+const unsigned long MAX_PARTITION_SLOTS = 32;
 const std::string PARTITION_FILE_NAME = "/f1x_partition";
-const PatchID INPUT_TERMINATOR = PatchID{0, 0, 0, 0, 0};
-const PatchID OUTPUT_TERMINATOR = PatchID{0, 0, 0, 0, 1};
+
+struct PartitionHeader {
+  unsigned long count;    // number of candidate ids
+  unsigned long slots;    // number of claimed slots, may exceed MAX_PARTITION_SLOTS
+  unsigned long overflow; // set when a thread could not claim a slot
+};
+
+struct PartitionSlot {
+  unsigned long count; // number of candidate indexes
+  unsigned long hits;  // hits of the active location in the thread
+  unsigned long busy;  // set while a hit refines the indexes
+};
+
+// edge coverage is stored by the runtime as one byte per edge (AFL-style)
+// and packed by the engine into a bitmap of COVERAGE_MAP_SIZE bits
+const unsigned long COVERAGE_MAP_SIZE = 1 << 16;
+const std::string COVERAGE_FILE_NAME = "/f1x_coverage";
+const std::string COVERAGE_COMPILER_FLAGS = "-fsanitize-coverage=trace-pc";
+
+typedef std::vector<unsigned long> CoverageBitmap;
+
+// the runtime terminates executions that hit the active location more than
+// WATCHDOG_FACTOR * (hits in the original program) + WATCHDOG_SLACK times
+const unsigned long WATCHDOG_FACTOR = 10;
+const unsigned long WATCHDOG_SLACK = 100;
+const unsigned WATCHDOG_EXIT_CODE = 121;
+const std::string WATCHDOG_FILE_NAME = "watchdog";
+
+// in shadow mode, the original program is executed and each location evaluates all its candidates
+// on the side; the runtime sets one byte per candidate (in generation order) when it diverges
+const unsigned long MAX_SHADOW_SIZE = 1 << 24;
+const std::string SHADOW_FILE_NAME = "/f1x_shadow";
+
+// in angelic mode, the runtime forces the truth values of one condition location (given as a prefix
+// of its hit sequence) and records the values it returned: the number of hits followed by one byte per hit
+const unsigned long MAX_ANGELIC_HITS = 1 << 16;
+const std::string ANGELIC_FILE_NAME = "/f1x_angelic";
+
+// in dependency mode, the runtime records which holes (BOOL2 and PARAMETER) of the active candidate
+// were evaluated during the execution as a bit mask; candidates that differ only in unevaluated holes
+// produce the same execution
+const unsigned long DEPENDS_ON_BOOL2 = 1;
+const unsigned long DEPENDS_ON_PARAM = 2;
+const std::string DEPENDENCY_FILE_NAME = "/f1x_dependency";
+
+
+// shared memory segments are named after the effective user and a hash of the canonical path of the
+// data directory, so that concurrent runs on one host are isolated; they are unlinked when the runtime
+// is destroyed, when the process exits and when it is terminated by a signal
+std::string sharedMemoryName(const std::string &name);
 
 
 class Runtime {
  public:
   Runtime();
-  void setPartition(std::unordered_set<PatchID> ids);
-  std::unordered_set<PatchID> getPartition();
+  ~Runtime();
+  Runtime(const Runtime&) = delete;
+  Runtime &operator=(const Runtime&) = delete;
+  void setPartition(const std::vector<PatchID> &ids);
+  bool getPartition(std::unordered_set<PatchID> &ids);
+  void clearCoverage();
+  CoverageBitmap getCoverage();
+  void clearWatchdog();
+  bool watchdogTriggered();
+  void clearShadow(unsigned long size);
+  bool diverged(unsigned long index);
+  void clearAngelic();
+  bool getAngelicValues(std::vector<bool> &values);
+  void clearDependencies();
+  unsigned long getDependencies();
   boost::filesystem::path getSource();
   boost::filesystem::path getHeader();
+  boost::filesystem::path getLibrary();
   bool compile();
 
  private:
+  PartitionHeader *partitionHeader;
   PatchID *partition;
+  PartitionSlot *partitionSlots;
+  unsigned *partitionIndexes;
+  unsigned char *coverage;
+  unsigned char *shadow;
+  unsigned char *angelic;
+  unsigned long *dependencies;
+
+  struct Segment {
+    std::string name;
+    void *memory;
+    size_t size;
+  };
+  std::vector<Segment> segments;
+  void *mapSharedMemory(const std::string &name, size_t size);
 };
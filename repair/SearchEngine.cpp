@@ -21,6 +21,10 @@
 #include <sstream>
 #include <memory>
 #include <chrono>
+#include <set>
+#include <algorithm>
+#include <deque>
+#include <thread>
 
 #include <boost/log/trivial.hpp>
 
@@ -30,6 +34,7 @@
 #include "Util.h"
 
 using std::unordered_set;
+using std::vector;
 using std::unordered_map;
 using std::shared_ptr;
 using std::string;
@@ -43,20 +48,49 @@ SearchEngine::SearchEngine(const std::vector<std::string> &tests,
                            TestingFramework &tester,
                            Runtime &runtime,
                            shared_ptr<unordered_map<unsigned long, unordered_set<PatchID>>> partitionable,
-                           std::unordered_map<Location, std::vector<unsigned>> relatedTestIndexes):
+                           std::unordered_map<Location, std::vector<unsigned>> relatedTestIndexes,
+                           std::unordered_map<Location, std::unordered_map<unsigned, unsigned long>> hitCounts,
+                           const TestScheduler &scheduler):
   tests(tests),
   tester(tester),
   runtime(runtime),
   partitionable(partitionable),
-  relatedTestIndexes(relatedTestIndexes) {
+  traces(tests.size()),
+  relatedTestIndexes(relatedTestIndexes),
+  hitCounts(hitCounts),
+  scheduler(scheduler) {
   
   stat.explorationCounter = 0;
   stat.executionCounter = 0;
   stat.timeoutCounter = 0;
   stat.nonTimeoutCounter = 0;
   stat.nonTimeoutTestTime = 0;
+  stat.adaptiveTimeoutCounter = 0;
+  stat.savedTestTime = 0;
+  stat.watchdogCounter = 0;
+  stat.replayRejectedCounter = 0;
+  stat.replayInferredCounter = 0;
+  stat.shadowExecutionCounter = 0;
+  stat.shadowRejectedCounter = 0;
+  stat.shadowInferredCounter = 0;
+  stat.angelicExecutionCounter = 0;
+  stat.angelicRejectedCounter = 0;
+  stat.dependencyInferredCounter = 0;
+  stat.partitionInferredCounter = 0;
+  stat.partitioningWarmupCounter = 0;
+  stat.partitioningEnabledCounter = 0;
+  stat.partitioningSampledCounter = 0;
+  stat.partitioningDisabledCounter = 0;
+  stat.sharedInferredCounter = 0;
+  stat.sharedSkippedCounter = 0;
+  stat.cacheHitCounter = 0;
+  stat.cacheStoredCounter = 0;
+  stat.retriedCounter = 0;
+  stat.confirmationCounter = 0;
+  stat.confirmationTestTime = 0;
 
   progress = 0;
+  retrying = false;
 
   //FIXME: I should use evaluation table instead
   failing = {};
@@ -64,10 +98,6 @@ SearchEngine::SearchEngine(const std::vector<std::string> &tests,
   for (auto &test : tests) {
     passing[test] = {};
   }
-
-  coverageDir = fs::path(cfg.dataDir) / "patch-coverage";
-  fs::create_directory(coverageDir);
-
 }
 
 
@@ -80,38 +110,486 @@ void SearchEngine::showProgress(unsigned long current, unsigned long total) {
 
 
 SearchStatistics SearchEngine::getStatistics() {
+  stat.partitioningWarmupCounter = 0;
+  stat.partitioningEnabledCounter = 0;
+  stat.partitioningSampledCounter = 0;
+  stat.partitioningDisabledCounter = 0;
+  for (auto &entry : partitioning) {
+    switch (entry.second.mode) {
+    case PartitioningMode::WARMUP:
+      stat.partitioningWarmupCounter++;
+      break;
+    case PartitioningMode::ENABLED:
+      stat.partitioningEnabledCounter++;
+      break;
+    case PartitioningMode::SAMPLED:
+      stat.partitioningSampledCounter++;
+      break;
+    case PartitioningMode::DISABLED:
+      stat.partitioningDisabledCounter++;
+      break;
+    }
+  }
   return stat;
 }
 
 
-std::unordered_map<std::string, std::unordered_map<PatchID, std::shared_ptr<Coverage>>> SearchEngine::getCoverageSet() {
-  return coverageSet;
+void SearchEngine::shareOutcomes(shared_ptr<OutcomeTable> table,
+                                 const unordered_map<PatchID, unsigned long> &indexes) {
+  outcomes = table;
+  outcomeIndexes = indexes;
+}
+
+
+void SearchEngine::cacheOutcomes(shared_ptr<OutcomeCache> cache,
+                                 const unordered_map<PatchID, std::size_t> &keys) {
+  this->cache = cache;
+  cacheKeys = keys;
+}
+
+
+void SearchEngine::onOutcome(std::function<void(unsigned, const PatchID&, bool)> listener) {
+  outcomeListener = listener;
+}
+
+
+void SearchEngine::onProgress(std::function<void(unsigned long)> listener) {
+  progressListener = listener;
+}
+
+
+SearchState SearchEngine::exportState() {
+  SearchState state;
+  state.failing = failing;
+  for (auto &test : tests)
+    state.passing.push_back(passing[test]);
+  state.deferred.assign(deferred.begin(), deferred.end());
+  state.distances = traces.getDistances();
+  state.stat = getStatistics();
+  return state;
+}
+
+
+void SearchEngine::importState(const SearchState &state) {
+  failing = state.failing;
+  for (unsigned i = 0; i < tests.size() && i < state.passing.size(); i++)
+    passing[tests[i]] = state.passing[i];
+  deferred.assign(state.deferred.begin(), state.deferred.end());
+  for (unsigned i = 0; i < tests.size() && i < state.distances.size(); i++) {
+    for (auto &entry : state.distances[i])
+      traces.setDistance(i, entry.first, entry.second);
+  }
+  stat = state.stat;
+}
+
+
+//NOTE: a failing candidate is excluded regardless of the test
+void SearchEngine::addOutcome(unsigned testIndex, const PatchID &id, bool passed) {
+  if (passed)
+    passing[tests[testIndex]].insert(id);
+  else
+    failing.insert(id);
+}
+
+
+void SearchEngine::publishOutcome(unsigned testIndex, const PatchID &id, bool passed, bool shared) {
+  if (outcomes && shared) {
+    auto index = outcomeIndexes.find(id);
+    if (index != outcomeIndexes.end())
+      outcomes->publish(testIndex, index->second, passed ? Outcome::PASS : Outcome::FAIL);
+  }
+  if (outcomeListener)
+    outcomeListener(testIndex, id, passed);
+}
+
+
+//NOTE: the key of a candidate already identifies the program and the timeout
+bool SearchEngine::getCacheKey(unsigned testIndex, const PatchID &id, std::size_t &key) {
+  auto candidateKey = cacheKeys.find(id);
+  if (candidateKey == cacheKeys.end())
+    return false;
+  key = candidateKey->second;
+  hash_combine(key, tests[testIndex]);
+  return true;
+}
+
+
+void SearchEngine::storeOutcome(unsigned testIndex, const PatchID &id, bool passed) {
+  std::size_t key;
+  if (getCacheKey(testIndex, id, key) && cache->put(key, passed ? Outcome::PASS : Outcome::FAIL))
+    stat.cacheStoredCounter++;
+}
+
+
+TraceStore &SearchEngine::getTraces() {
+  return traces;
+}
+
+
+//NOTE: the original program is executed with the runtime, so that adaptive timeouts account for
+// its overhead, and traced for ranking by semantic difference
+void SearchEngine::runOriginal() {
+  BOOST_LOG_TRIVIAL(info) << "executing original program with runtime";
+  InEnvironment env({ { "F1X_APP", "0" },
+                      { "F1X_ID_BASE", "0" },
+                      { "F1X_ID_INT2", "0" },
+                      { "F1X_ID_BOOL2", "0" },
+                      { "F1X_ID_COND3", "0" },
+                      { "F1X_ID_PARAM", "0" } });
+  for (unsigned testIndex = 0; testIndex < tests.size(); testIndex++) {
+    if (cfg.patchPrioritization == PatchPrioritization::SEMANTIC_DIFF)
+      runtime.clearCoverage();
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    TestStatus status = tester.execute(tests[testIndex]);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    if (status != TestStatus::TIMEOUT) {
+      scheduler.recordBaseline(testIndex,
+                               std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count());
+    }
+    if (cfg.patchPrioritization == PatchPrioritization::SEMANTIC_DIFF)
+      traces.setOriginal(testIndex, traces.intern(runtime.getCoverage()));
+  }
+}
+
+
+//NOTE: a candidate that does not change the execution of a test has the outcome of the original program
+void SearchEngine::replayValues(const std::vector<Patch> &searchSpace,
+                                ValueReplay &replay,
+                                const std::vector<bool> &originalPassing) {
+  BOOST_LOG_TRIVIAL(info) << "replaying candidates on profiled values";
+  for (auto &elem : searchSpace) {
+    std::vector<unsigned> unchanged = replay.unchangedTests(elem);
+    for (auto testIndex : unchanged) {
+      if (!originalPassing[testIndex]) {
+        failing.insert(elem.id);
+        stat.replayRejectedCounter++;
+        break;
+      }
+    }
+    if (failing.count(elem.id))
+      continue;
+    for (auto testIndex : unchanged) {
+      passing[tests[testIndex]].insert(elem.id);
+      stat.replayInferredCounter++;
+    }
+  }
+}
+
+
+/*
+  Each test is executed once with the original program while every location evaluates
+  all its candidates on the side. Candidates that never diverged from the original value
+  do not change the execution, so they inherit the original outcome.
+*/
+void SearchEngine::shadowEvaluate(const std::vector<Patch> &searchSpace,
+                                  const std::unordered_map<PatchID, unsigned long> &shadowIndexes,
+                                  const std::vector<bool> &originalPassing) {
+  if (shadowIndexes.size() > MAX_SHADOW_SIZE) {
+    BOOST_LOG_TRIVIAL(warning) << "search space is too large for shadow evaluation";
+  }
+
+  std::set<unsigned> relatedTests;
+  for (auto &entry : relatedTestIndexes) {
+    relatedTests.insert(entry.second.begin(), entry.second.end());
+  }
+
+  BOOST_LOG_TRIVIAL(info) << "shadow evaluation of candidates";
+  InEnvironment env({ { "F1X_APP", "0" },
+                      { "F1X_SHADOW", "1" },
+                      { "F1X_ID_BASE", "0" },
+                      { "F1X_ID_INT2", "0" },
+                      { "F1X_ID_BOOL2", "0" },
+                      { "F1X_ID_COND3", "0" },
+                      { "F1X_ID_PARAM", "0" } });
+
+  for (auto testIndex : relatedTests) {
+    runtime.clearShadow(std::min(shadowIndexes.size(), MAX_SHADOW_SIZE));
+    TestStatus status = tester.execute(tests[testIndex]);
+    stat.shadowExecutionCounter++;
+    //NOTE: shadow evaluation must not affect the execution; otherwise, the results are ignored
+    if ((status == TestStatus::PASS) != originalPassing[testIndex]) {
+      BOOST_LOG_TRIVIAL(warning) << "test " << tests[testIndex] << " changed outcome in shadow mode";
+      continue;
+    }
+
+    for (auto &elem : searchSpace) {
+      if (failing.count(elem.id))
+        continue;
+      auto index = shadowIndexes.find(elem.id);
+      if (index == shadowIndexes.end() || index->second >= MAX_SHADOW_SIZE || runtime.diverged(index->second))
+        continue;
+      std::vector<unsigned> &related = relatedTestIndexes[elem.app->location];
+      if (std::find(related.begin(), related.end(), testIndex) == related.end())
+        continue;
+      if (!originalPassing[testIndex]) {
+        failing.insert(elem.id);
+        stat.shadowRejectedCounter++;
+      } else if (!passing[tests[testIndex]].count(elem.id)) {
+        passing[tests[testIndex]].insert(elem.id);
+        stat.shadowInferredCounter++;
+      }
+    }
+  }
+}
+
+
+/*
+  Truth values are forced at the hits of a condition location to find the sequences of values
+  that make a failing test pass (angelic values). Each execution forces a prefix and records
+  the values of the remaining hits; its successors flip one of the recorded values. Exploring
+  this tree completely enumerates all sequences that can occur in the test.
+*/
+bool SearchEngine::exploreAngelicValues(shared_ptr<SchemaApplication> app,
+                                        unsigned testIndex,
+                                        std::vector<std::vector<bool>> &angelicValues) {
+  unsigned long hitLimit = 0;
+  auto locationHits = hitCounts.find(app->location);
+  if (locationHits != hitCounts.end() && locationHits->second.count(testIndex)) {
+    hitLimit = WATCHDOG_FACTOR * locationHits->second[testIndex] + WATCHDOG_SLACK;
+  }
+  InEnvironment env({ { "F1X_APP", "0" },
+                      { "F1X_ANGELIC", to_string(app->id) },
+                      { "F1X_ID_BASE", "0" },
+                      { "F1X_ID_INT2", "0" },
+                      { "F1X_ID_BOOL2", "0" },
+                      { "F1X_ID_COND3", "0" },
+                      { "F1X_ID_PARAM", "0" },
+                      { "F1X_HIT_LIMIT", to_string(hitLimit) } });
+
+  std::deque<string> prefixes = { "" };
+  unsigned long probes = 0;
+  while (!prefixes.empty()) {
+    if (probes == MAX_ANGELIC_PROBES)
+      return false;
+    string prefix = prefixes.front();
+    prefixes.pop_front();
+
+    InEnvironment prefixEnv({ { "F1X_ANGELIC_PREFIX", prefix } });
+    runtime.clearAngelic();
+    runtime.clearWatchdog();
+    TestStatus status = tester.execute(tests[testIndex], scheduler.getTimeout(testIndex));
+    probes++;
+    stat.angelicExecutionCounter++;
+    if (runtime.watchdogTriggered())
+      status = TestStatus::FAIL;
+
+    std::vector<bool> values;
+    if (!runtime.getAngelicValues(values))
+      return false;
+    if (status == TestStatus::PASS)
+      angelicValues.push_back(values);
+
+    for (unsigned long hit = prefix.size(); hit < values.size(); hit++) {
+      string successor;
+      for (unsigned long i = 0; i < hit; i++) {
+        successor += values[i] ? '1' : '0';
+      }
+      successor += values[hit] ? '0' : '1';
+      prefixes.push_back(successor);
+    }
+  }
+  return true;
+}
+
+
+/*
+  A candidate makes a test pass only if its sequence of values is angelic. Before diverging
+  from the original program, the candidate follows the original execution, so its values
+  up to the first divergence are obtained by replaying profiled values. If the angelic values
+  are completely enumerated and none of them starts with this prefix, the candidate fails.
+*/
+void SearchEngine::angelicSearch(const std::vector<Patch> &searchSpace,
+                                 ValueReplay &replay,
+                                 const std::vector<bool> &originalPassing) {
+  BOOST_LOG_TRIVIAL(info) << "searching angelic values of conditions";
+
+  std::vector<shared_ptr<SchemaApplication>> apps;
+  unordered_map<AppID, std::vector<unsigned long>> candidatesByApp;
+  for (unsigned long i = 0; i < searchSpace.size(); i++) {
+    const Patch &elem = searchSpace[i];
+    if (elem.app->context != LocationContext::CONDITION)
+      continue;
+    if (!candidatesByApp.count(elem.app->id))
+      apps.push_back(elem.app);
+    candidatesByApp[elem.app->id].push_back(i);
+  }
+
+  for (auto &app : apps) {
+    std::vector<unsigned long> &candidates = candidatesByApp[app->id];
+    for (auto testIndex : relatedTestIndexes[app->location]) {
+      if (originalPassing[testIndex])
+        continue;
+      bool explored = std::all_of(candidates.begin(), candidates.end(), [&](unsigned long i) {
+          return failing.count(searchSpace[i].id) > 0;
+        });
+      if (explored)
+        break;
+
+      std::vector<std::vector<bool>> angelicValues;
+      if (!exploreAngelicValues(app, testIndex, angelicValues)) {
+        BOOST_LOG_TRIVIAL(debug) << "angelic values of location " << app->id
+                                 << " in test " << tests[testIndex] << " exceed the budget";
+        continue;
+      }
+      BOOST_LOG_TRIVIAL(debug) << "found " << angelicValues.size() << " angelic value sequences of location "
+                               << app->id << " in test " << tests[testIndex];
+
+      for (auto i : candidates) {
+        const Patch &elem = searchSpace[i];
+        if (failing.count(elem.id))
+          continue;
+        std::vector<bool> prefix;
+        if (!replay.divergencePrefix(elem, testIndex, prefix))
+          continue;
+        bool angelic = std::any_of(angelicValues.begin(), angelicValues.end(), [&](const std::vector<bool> &values) {
+            return values.size() >= prefix.size() && std::equal(prefix.begin(), prefix.end(), values.begin());
+          });
+        if (!angelic) {
+          failing.insert(elem.id);
+          stat.angelicRejectedCounter++;
+        }
+      }
+    }
+  }
+}
+
+
+/*
+  Candidates with the same base that differ from the executed one only in holes
+  that it did not evaluate (base ids are unique across locations)
+ */
+unordered_set<PatchID> SearchEngine::dependencyPartition(const std::vector<Patch> &searchSpace,
+                                                         const PatchID &id,
+                                                         unsigned long dependencies) {
+  if (candidatesByBase.empty()) {
+    for (unsigned long i = 0; i < searchSpace.size(); i++) {
+      candidatesByBase[searchSpace[i].id.base].push_back(i);
+    }
+  }
+
+  unordered_set<PatchID> result;
+  if ((dependencies & DEPENDS_ON_BOOL2) && (dependencies & DEPENDS_ON_PARAM))
+    return result;
+
+  for (auto i : candidatesByBase[id.base]) {
+    const PatchID &other = searchSpace[i].id;
+    if (other == id || other.int2 != id.int2 || other.cond3 != id.cond3)
+      continue;
+    if ((dependencies & DEPENDS_ON_BOOL2) && other.bool2 != id.bool2)
+      continue;
+    if ((dependencies & DEPENDS_ON_PARAM) && other.param != id.param)
+      continue;
+    result.insert(other);
+  }
+  return result;
+}
+
+
+bool SearchEngine::shouldPartition(AppID app) {
+  if (!partitioning.count(app)) {
+    partitioning[app] = PartitioningProfile{PartitioningMode::WARMUP, 0, 0, 0, 0, 0, 0};
+  }
+  const PartitioningProfile &profile = partitioning[app];
+  switch (profile.mode) {
+  case PartitioningMode::WARMUP:
+    return profile.executions % 2 == 0;
+  case PartitioningMode::ENABLED:
+    return true;
+  case PartitioningMode::SAMPLED:
+    return profile.executions % PARTITIONING_SAMPLING_PERIOD == 0;
+  case PartitioningMode::DISABLED:
+    return profile.executions % PARTITIONING_PROBING_PERIOD == 0;
+  }
+  return true;
 }
 
 
-//FIXME: this probably does not work. Tests should be prioritized based on global score
-void SearchEngine::prioritizeTest(std::vector<unsigned> &testOrder, unsigned index) {
-    std::vector<unsigned>::iterator it = testOrder.begin() + index;
-    unsigned temp = testOrder[index];
-    testOrder.erase(it);
-    testOrder.insert(testOrder.begin(), temp);
+//NOTE: each settled candidate saves at least one execution, which is weighed against the time partitioning adds
+void SearchEngine::recordPartitioning(AppID app, bool partitioned, unsigned long time, unsigned long settled) {
+  PartitioningProfile &profile = partitioning[app];
+  profile.executions++;
+  if (partitioned) {
+    profile.partitionedExecutions++;
+    profile.partitionedTime += time;
+    profile.settled += settled;
+  } else {
+    profile.plainExecutions++;
+    profile.plainTime += time;
+  }
+
+  if (profile.executions < PARTITIONING_WARMUP)
+    return;
+  if (profile.mode != PartitioningMode::WARMUP &&
+      (profile.executions - PARTITIONING_WARMUP) % PARTITIONING_REVIEW_PERIOD != 0)
+    return;
+  if (profile.partitionedExecutions == 0 || profile.plainExecutions == 0)
+    return;
+
+  double plainMean = double(profile.plainTime) / profile.plainExecutions;
+  double partitionedMean = double(profile.partitionedTime) / profile.partitionedExecutions;
+  double overhead = std::max(0.0, partitionedMean - plainMean);
+  double gain = plainMean * profile.settled / profile.partitionedExecutions;
+
+  PartitioningMode mode;
+  if (gain >= overhead) {
+    mode = PartitioningMode::ENABLED;
+  } else if (profile.settled > 0) {
+    mode = PartitioningMode::SAMPLED;
+  } else {
+    mode = PartitioningMode::DISABLED;
+  }
+
+  if (mode != profile.mode) {
+    BOOST_LOG_TRIVIAL(debug) << "partitioning at location " << app << " is "
+                             << (mode == PartitioningMode::ENABLED ? "enabled" :
+                                 (mode == PartitioningMode::SAMPLED ? "sampled" : "disabled"))
+                             << " (" << double(profile.settled) / profile.partitionedExecutions
+                             << " candidates settled per execution, "
+                             << overhead << " us overhead)";
+  }
+  profile.mode = mode;
+}
+
+
+//NOTE: deferred candidates are re-executed after their claims are polled, and removed only after that,
+// so that a checkpoint taken meanwhile still contains them
+unsigned long SearchEngine::findDeferred(const std::vector<Patch> &searchSpace) {
+  retrying = true;
+  unsigned long found = searchSpace.size();
+  while (!deferred.empty() && found == searchSpace.size()) {
+    unsigned long index = deferred.front();
+    stat.retriedCounter++;
+    if (findNext(searchSpace, index, index + 1) == index)
+      found = index;
+    deferred.pop_front();
+  }
+  retrying = false;
+  return found;
 }
 
 
 unsigned long SearchEngine::findNext(const std::vector<Patch> &searchSpace,
                                      unsigned long from) {
+  return findNext(searchSpace, from, searchSpace.size());
+}
+
+
+unsigned long SearchEngine::findNext(const std::vector<Patch> &searchSpace,
+                                     unsigned long from,
+                                     unsigned long to) {
 
   unsigned long index = from;
-  for (; index < searchSpace.size(); index++) {
+  for (; index < to; index++) {
+    if (progressListener)
+      progressListener(index);
+
     stat.explorationCounter++;
     showProgress(index, searchSpace.size());
 
     const Patch &elem = searchSpace[index];
 
-    if (cfg.valueTEQ) {
-      if (failing.count(elem.id))
-        continue;
-    }
+    if (failing.count(elem.id))
+      continue;
 
     InEnvironment env({ { "F1X_APP", to_string(elem.app->id) },
                         { "F1X_ID_BASE", to_string(elem.id.base) },
@@ -122,34 +600,140 @@ unsigned long SearchEngine::findNext(const std::vector<Patch> &searchSpace,
 
     bool passAll = true;
 
-    std::vector<unsigned> testOrder = relatedTestIndexes[elem.app->location];
+    std::vector<unsigned> testOrder;
+    if (cfg.testPrioritization == TestPrioritization::MAX_FAILING) {
+      testOrder = scheduler.order(elem.app->location, relatedTestIndexes[elem.app->location]);
+    } else {
+      testOrder = relatedTestIndexes[elem.app->location];
+    }
+    //NOTE: tests that exceed adaptive timeouts are appended to be confirmed with the global timeout
+    unsigned long confirmFrom = testOrder.size();
+
+    auto sharedIndex = outcomeIndexes.end();
+    if (outcomes)
+      sharedIndex = outcomeIndexes.find(elem.id);
 
     for (unsigned orderIndex = 0; orderIndex < testOrder.size(); orderIndex++) {
       auto test = tests[testOrder[orderIndex]];
 
-      if (cfg.valueTEQ) {
-        if (passing[test].count(elem.id))
+      if (passing[test].count(elem.id))
+        continue;
+
+      //NOTE: cached passes are not used when ranking by coverage, since their coverage is not traced
+      std::size_t cacheKey;
+      if (cache && getCacheKey(testOrder[orderIndex], elem.id, cacheKey)) {
+        Outcome cached = cache->get(cacheKey);
+        if (cached == Outcome::PASS && cfg.patchPrioritization == PatchPrioritization::SEMANTIC_DIFF)
+          cached = Outcome::UNKNOWN;
+        if (cached == Outcome::PASS || cached == Outcome::FAIL) {
+          stat.cacheHitCounter++;
+          bool passed = (cached == Outcome::PASS);
+          if (outcomes || outcomeListener)
+            publishOutcome(testOrder[orderIndex], elem.id, passed);
+          if (passed) {
+            passing[test].insert(elem.id);
+            continue;
+          }
+          failing.insert(elem.id);
+          passAll = false;
+          break;
+        }
+      }
+
+      //NOTE: a candidate claimed by another worker is deferred until the end of the search, and then
+      // polled until its outcome is published or the claim is taken over from a terminated worker
+      if (sharedIndex != outcomeIndexes.end()) {
+        Outcome known = outcomes->get(testOrder[orderIndex], sharedIndex->second);
+        if (known == Outcome::UNKNOWN || known == Outcome::CLAIMED)
+          known = outcomes->claim(testOrder[orderIndex], sharedIndex->second) ?
+            Outcome::UNKNOWN : outcomes->get(testOrder[orderIndex], sharedIndex->second);
+        if (known == Outcome::PASS) {
+          stat.sharedInferredCounter++;
+          passing[test].insert(elem.id);
           continue;
+        }
+        if (known == Outcome::FAIL) {
+          stat.sharedInferredCounter++;
+          failing.insert(elem.id);
+          passAll = false;
+          break;
+        }
+        if (known == Outcome::CLAIMED) {
+          stat.sharedSkippedCounter++;
+          if (retrying)
+            std::this_thread::sleep_for(std::chrono::milliseconds(CLAIM_POLLING_INTERVAL));
+          deferred.push_back(index);
+          passAll = false;
+          break;
+        }
+      }
+
+      std::chrono::steady_clock::time_point partitionBegin = std::chrono::steady_clock::now();
 
-        //FIXME: select only unexplored candidates
-        runtime.setPartition((*partitionable)[elem.app->id]);
+      //NOTE: candidates with known outcomes and the active one are not evaluated by the runtime;
+      // an empty partition makes the runtime skip evaluating other candidates
+      bool partitioned = cfg.valueTEQ && shouldPartition(elem.app->id);
+      if (cfg.valueTEQ) {
+        vector<PatchID> unexplored;
+        if (partitioned) {
+          for (auto &id : (*partitionable)[elem.app->id]) {
+            if (!(id == elem.id) && !failing.count(id) && !passing[test].count(id))
+              unexplored.push_back(id);
+          }
+        }
+        runtime.setPartition(unexplored);
       }
 
       BOOST_LOG_TRIVIAL(debug) << "executing candidate " << visualizePatchID(elem.id) 
                                << " with test " << test;
 
+      if (cfg.patchPrioritization == PatchPrioritization::SEMANTIC_DIFF)
+        runtime.clearCoverage();
+
+      if (cfg.dependencyTEQ)
+        runtime.clearDependencies();
+
+      //NOTE: 0 disables the watchdog, e.g. when the original program crashed during profiling
+      unsigned long hitLimit = 0;
+      auto locationHits = hitCounts.find(elem.app->location);
+      if (locationHits != hitCounts.end() && locationHits->second.count(testOrder[orderIndex])) {
+        hitLimit = WATCHDOG_FACTOR * locationHits->second[testOrder[orderIndex]] + WATCHDOG_SLACK;
+      }
+      InEnvironment watchdogEnv({ { "F1X_HIT_LIMIT", to_string(hitLimit) } });
+      runtime.clearWatchdog();
+
       std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
 
-      TestStatus status = tester.execute(test);
+      bool confirming = (orderIndex >= confirmFrom);
+      unsigned long timeout = confirming ? tester.getTimeout() : scheduler.getTimeout(testOrder[orderIndex]);
+      TestStatus status = tester.execute(test, timeout);
 
       std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
 
+      bool terminated = runtime.watchdogTriggered();
+      if (terminated) {
+        BOOST_LOG_TRIVIAL(debug) << "terminated by watchdog";
+        stat.watchdogCounter++;
+        status = TestStatus::FAIL;
+      }
+
+      unsigned long testTime = std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count();
+      scheduler.record(elem.app->location, testOrder[orderIndex], status, testTime);
+
       stat.executionCounter++;
+      if (confirming) {
+        stat.confirmationCounter++;
+        stat.confirmationTestTime += tester.getTimeout();
+      }
       if (status != TestStatus::TIMEOUT) {
         stat.nonTimeoutCounter++;
-        stat.nonTimeoutTestTime += std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count();
+        stat.nonTimeoutTestTime += testTime;
       } else {
         stat.timeoutCounter++;
+        if (timeout < tester.getTimeout()) {
+          stat.adaptiveTimeoutCounter++;
+          stat.savedTestTime += tester.getTimeout() - timeout;
+        }
       }
 
       switch (status) {
@@ -164,29 +748,69 @@ unsigned long SearchEngine::findNext(const std::vector<Patch> &searchSpace,
         break;
       }
 
+      //NOTE: a timeout shorter than the global one rejects the candidate unless all its other tests
+      // pass; only then the test is confirmed with the global timeout, and no outcomes are inferred
+      if (status == TestStatus::TIMEOUT && timeout < tester.getTimeout()) {
+        if (sharedIndex != outcomeIndexes.end())
+          outcomes->release(testOrder[orderIndex], sharedIndex->second);
+        testOrder.push_back(testOrder[orderIndex]);
+        continue;
+      }
+
       passAll = (status == TestStatus::PASS);
 
-      if (cfg.valueTEQ) {
-        unordered_set<PatchID> partition = runtime.getPartition();
-        if (partition.empty()) {
-          //NOTE: it should contain at least the current element
+      unordered_set<PatchID> partition;
+      if (partitioned) {
+        if (!runtime.getPartition(partition)) {
           BOOST_LOG_TRIVIAL(warning) << "partitioning failed for "
                                      << visualizePatchID(elem.id)
                                      << " with test " << test;
         }
+      }
 
-        if (cfg.patchPrioritization == PatchPrioritization::SEMANTIC_DIFF) {
-          fs::path coverageFile = coverageDir / (test + "_" + std::to_string(index) + ".xml");
-          std::shared_ptr<Coverage> curCoverage(new Coverage(extractAndSaveCoverage(coverageFile)));
-
-          if (!coverageSet.count(test))
-            coverageSet[test] = std::unordered_map<PatchID, std::shared_ptr<Coverage>>();
+      if (cfg.valueTEQ) {
+        std::chrono::steady_clock::time_point partitionEnd = std::chrono::steady_clock::now();
+        unsigned long partitionTime =
+          std::chrono::duration_cast<std::chrono::microseconds>(partitionEnd - partitionBegin).count();
+        stat.partitionInferredCounter += partition.size();
+        recordPartitioning(elem.app->id, partitioned, partitionTime, partition.size());
+      }
 
-          coverageSet[test][elem.id] = curCoverage;
-          for (auto &id : partition)
-            coverageSet[test][id] = curCoverage;
+      //NOTE: timeouts are not grouped, since they depend on the load of the machine
+      if (cfg.dependencyTEQ && status != TestStatus::TIMEOUT) {
+        for (auto &id : dependencyPartition(searchSpace, elem.id, runtime.getDependencies())) {
+          if (partition.insert(id).second)
+            stat.dependencyInferredCounter++;
         }
+      }
+
+      //NOTE: only passing executions are traced, since only plausible patches are ranked
+      if (cfg.patchPrioritization == PatchPrioritization::SEMANTIC_DIFF && passAll) {
+        TraceID trace = traces.intern(runtime.getCoverage());
+        traces.assign(testOrder[orderIndex], elem.id, trace);
+        for (auto &id : partition)
+          traces.assign(testOrder[orderIndex], id, trace);
+      }
 
+      //NOTE: outcomes that depend on the watchdog are specific to the profile of this run,
+      // so they are not shared with other workers, which execute the candidate themselves
+      if (outcomes || outcomeListener) {
+        publishOutcome(testOrder[orderIndex], elem.id, passAll, !terminated);
+        for (auto &id : partition)
+          publishOutcome(testOrder[orderIndex], id, passAll, !terminated);
+      }
+      if (terminated && sharedIndex != outcomeIndexes.end())
+        outcomes->release(testOrder[orderIndex], sharedIndex->second);
+
+      //NOTE: outcomes that depend on the watchdog are not persisted, since they are specific
+      // to the profile of this run
+      if (cache && !terminated) {
+        storeOutcome(testOrder[orderIndex], elem.id, passAll);
+        for (auto &id : partition)
+          storeOutcome(testOrder[orderIndex], id, passAll);
+      }
+
+      if (cfg.valueTEQ || cfg.dependencyTEQ) {
         if (passAll) {
           passing[test].insert(elem.id);
           passing[test].insert(partition.begin(), partition.end());
@@ -198,9 +822,6 @@ unsigned long SearchEngine::findNext(const std::vector<Patch> &searchSpace,
       }
 
       if (!passAll) {
-        if (cfg.testPrioritization == TestPrioritization::MAX_FAILING) {
-          prioritizeTest(relatedTestIndexes[elem.app->location], orderIndex);
-        }
         break;
       }
     }
@@ -23,10 +23,16 @@
 #include <unordered_map>
 #include <map>
 #include <vector>
+#include <functional>
+#include <deque>
 #include "Util.h"
 #include "Project.h"
 #include "Runtime.h"
-#include "FaultLocalization.h"
+#include "TraceStore.h"
+#include "TestScheduler.h"
+#include "ValueReplay.h"
+#include "OutcomeTable.h"
+#include "OutcomeCache.h"
 
 
 struct SearchStatistics {
@@ -35,6 +41,68 @@ struct SearchStatistics {
   unsigned long timeoutCounter;
   unsigned long nonTimeoutCounter;
   unsigned long nonTimeoutTestTime;
+  unsigned long adaptiveTimeoutCounter; // timeouts shorter than the global timeout
+  unsigned long savedTestTime;          // milliseconds saved by adaptive timeouts
+  unsigned long watchdogCounter;        // executions terminated by the loop watchdog
+  unsigned long replayRejectedCounter;  // candidates rejected by replaying profiled values
+  unsigned long replayInferredCounter;  // passing test outcomes inferred by replaying profiled values
+  unsigned long shadowExecutionCounter; // executions of the original program in shadow mode
+  unsigned long shadowRejectedCounter;  // candidates rejected by shadow evaluation
+  unsigned long shadowInferredCounter;  // passing test outcomes inferred by shadow evaluation
+  unsigned long angelicExecutionCounter; // executions with forced condition values
+  unsigned long angelicRejectedCounter;  // candidates rejected by angelic value search
+  unsigned long dependencyInferredCounter; // test outcomes inferred from unevaluated holes
+  unsigned long partitionInferredCounter;  // test outcomes inferred by value-based partitioning
+  unsigned long partitioningWarmupCounter;   // locations where partitioning is still being evaluated
+  unsigned long partitioningEnabledCounter;  // locations where partitioning is always applied
+  unsigned long partitioningSampledCounter;  // locations where partitioning is sampled
+  unsigned long partitioningDisabledCounter; // locations where partitioning is only probed
+  unsigned long sharedInferredCounter;  // test outcomes read from the shared outcome table
+  unsigned long sharedSkippedCounter;   // candidates skipped since another worker executes them
+  unsigned long cacheHitCounter;        // test outcomes read from the persistent outcome cache
+  unsigned long cacheStoredCounter;     // test outcomes added to the persistent outcome cache
+  unsigned long retriedCounter;         // deferred candidates retried after the search
+  unsigned long confirmationCounter;    // adaptive timeouts re-executed with the global timeout
+  unsigned long confirmationTestTime;   // milliseconds of saved time lost to confirmations
+};
+
+
+// outcomes and statistics of a search, which are saved in checkpoints
+struct SearchState {
+  std::unordered_set<PatchID> failing;
+  std::vector<std::unordered_set<PatchID>> passing; // by test index
+  std::vector<unsigned long> deferred;
+  std::vector<std::unordered_map<PatchID, unsigned>> distances; // semantic, by test index
+  SearchStatistics stat;
+};
+
+
+// maximum number of executions to search angelic values of a location in a test
+const unsigned long MAX_ANGELIC_PROBES = 64;
+
+// value-based partitioning is decided per location after a warmup, in which partitioned and plain
+// executions alternate, and revised periodically; sampled locations partition every n-th execution,
+// and disabled locations still partition occasionally, so that they can be enabled again
+const unsigned long PARTITIONING_WARMUP = 16;
+const unsigned long PARTITIONING_REVIEW_PERIOD = 64;
+const unsigned long PARTITIONING_SAMPLING_PERIOD = 8;
+const unsigned long PARTITIONING_PROBING_PERIOD = 32;
+
+enum class PartitioningMode {
+  WARMUP,
+  ENABLED,
+  SAMPLED,
+  DISABLED
+};
+
+struct PartitioningProfile {
+  PartitioningMode mode;
+  unsigned long executions;
+  unsigned long partitionedExecutions;
+  unsigned long partitionedTime; // microseconds, including shared memory exchange
+  unsigned long plainExecutions;
+  unsigned long plainTime;       // microseconds
+  unsigned long settled;         // candidates with outcomes inferred from partitions
 };
 
 
@@ -44,25 +112,69 @@ class SearchEngine {
                TestingFramework &tester,
                Runtime &runtime,
                std::shared_ptr<std::unordered_map<unsigned long, std::unordered_set<PatchID>>> partitionable,
-               std::unordered_map<Location, std::vector<unsigned>> relatedTestIndexes);
+               std::unordered_map<Location, std::vector<unsigned>> relatedTestIndexes,
+               std::unordered_map<Location, std::unordered_map<unsigned, unsigned long>> hitCounts,
+               const TestScheduler &scheduler);
 
   unsigned long findNext(const std::vector<Patch> &searchSpace, unsigned long fromIdx);
-  std::unordered_map<std::string, std::unordered_map<PatchID, std::shared_ptr<Coverage>>> getCoverageSet();
+  unsigned long findNext(const std::vector<Patch> &searchSpace, unsigned long fromIdx, unsigned long toIdx);
+  unsigned long findDeferred(const std::vector<Patch> &searchSpace);
+  void runOriginal();
+  void replayValues(const std::vector<Patch> &searchSpace,
+                    ValueReplay &replay,
+                    const std::vector<bool> &originalPassing);
+  void shadowEvaluate(const std::vector<Patch> &searchSpace,
+                      const std::unordered_map<PatchID, unsigned long> &shadowIndexes,
+                      const std::vector<bool> &originalPassing);
+  void angelicSearch(const std::vector<Patch> &searchSpace,
+                     ValueReplay &replay,
+                     const std::vector<bool> &originalPassing);
+  void shareOutcomes(std::shared_ptr<OutcomeTable> table,
+                     const std::unordered_map<PatchID, unsigned long> &indexes);
+  void cacheOutcomes(std::shared_ptr<OutcomeCache> cache,
+                     const std::unordered_map<PatchID, std::size_t> &keys);
+  void onOutcome(std::function<void(unsigned, const PatchID&, bool)> listener);
+  void onProgress(std::function<void(unsigned long)> listener);
+  SearchState exportState();
+  void importState(const SearchState &state);
+  void addOutcome(unsigned testIndex, const PatchID &id, bool passed);
+  TraceStore &getTraces();
   SearchStatistics getStatistics();
   void showProgress(unsigned long current, unsigned long total);
 
  private:
- 
-  void prioritizeTest(std::vector<unsigned> &testOrder, unsigned index);
+  bool exploreAngelicValues(std::shared_ptr<SchemaApplication> app,
+                            unsigned testIndex,
+                            std::vector<std::vector<bool>> &angelicValues);
+  std::unordered_set<PatchID> dependencyPartition(const std::vector<Patch> &searchSpace,
+                                                  const PatchID &id,
+                                                  unsigned long dependencies);
+  bool shouldPartition(AppID app);
+  void recordPartitioning(AppID app, bool partitioned, unsigned long time, unsigned long settled);
+  void publishOutcome(unsigned testIndex, const PatchID &id, bool passed, bool shared = true);
+  bool getCacheKey(unsigned testIndex, const PatchID &id, std::size_t &key);
+  void storeOutcome(unsigned testIndex, const PatchID &id, bool passed);
+
   std::vector<std::string> tests;
   TestingFramework tester;
-  Runtime runtime;
+  Runtime &runtime;
   SearchStatistics stat;
   unsigned long progress;
   std::shared_ptr<std::unordered_map<unsigned long, std::unordered_set<PatchID>>> partitionable;
   std::unordered_set<PatchID> failing;
   std::unordered_map<std::string, std::unordered_set<PatchID>> passing;
-  std::unordered_map<std::string, std::unordered_map<PatchID, std::shared_ptr<Coverage>>> coverageSet;
+  TraceStore traces;
   std::unordered_map<Location, std::vector<unsigned>> relatedTestIndexes;
-  boost::filesystem::path coverageDir;
+  std::unordered_map<Location, std::unordered_map<unsigned, unsigned long>> hitCounts;
+  TestScheduler scheduler;
+  std::unordered_map<unsigned long, std::vector<unsigned long>> candidatesByBase;
+  std::unordered_map<AppID, PartitioningProfile> partitioning;
+  std::shared_ptr<OutcomeTable> outcomes;
+  std::unordered_map<PatchID, unsigned long> outcomeIndexes;
+  std::shared_ptr<OutcomeCache> cache;
+  std::unordered_map<PatchID, std::size_t> cacheKeys;
+  std::function<void(unsigned, const PatchID&, bool)> outcomeListener;
+  std::function<void(unsigned long)> progressListener;
+  std::deque<unsigned long> deferred; // indexes of candidates claimed by other workers
+  bool retrying;
 };
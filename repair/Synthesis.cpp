@@ -23,11 +23,13 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "Synthesis.h"
 #include "Runtime.h"
 #include "Typing.h"
 #include "Global.h"
+#include "Prioritization.h"
 
 namespace fs = boost::filesystem;
 
@@ -37,6 +39,7 @@ using std::vector;
 using std::string;
 using std::shared_ptr;
 using std::unordered_map;
+using std::unordered_set;
 using std::to_string;
 using std::stack;
 
@@ -229,15 +232,44 @@ namespace synthesis {
     return Expression{expr.kind, expr.type, expr.op, expr.rawType, expr.repr, {expr.args[0], subs}};
   }
 
+  unsigned integerWidth(const string &rawType) {
+    if (rawType == "char" || rawType == "signed char" || rawType == "unsigned char")
+      return 8;
+    if (rawType == "short" || rawType == "unsigned short")
+      return 16;
+    if (rawType == "int" || rawType == "unsigned int" || rawType == "unsigned" || rawType == "wchar_t")
+      return 32;
+    if (rawType == "long" || rawType == "unsigned long" || rawType == "long long" || rawType == "unsigned long long")
+      return 64;
+    return 0; // unknown
+  }
+
+  // pairs of components that are compared in BOOL2 expressions
+  bool comparablePair(const Expression &left, const Expression &right) {
+    if (left.type != right.type)
+      return false;
+    if (left.kind == NodeKind::CONSTANT && right.kind == NodeKind::CONSTANT)
+      return false;
+    if (left.type == Type::POINTER)
+      return left.rawType == right.rawType;
+    //NOTE: characters are not compared with pointer-sized integers
+    unsigned leftWidth = integerWidth(left.rawType);
+    unsigned rightWidth = integerWidth(right.rawType);
+    return !((leftWidth == 8 && rightWidth == 64) || (leftWidth == 64 && rightWidth == 8));
+  }
+
+  //NOTE: each unordered pair is used once, since "x < y" is equivalent to "y > x"
   vector<Expression> bool2Expressions(const vector<Expression> &components) {
     vector<Expression> result;
-    for (auto &left : components) {
+    for (unsigned long i = 0; i < components.size(); i++) {
+      const Expression &left = components[i];
       switch (left.type) {
       case Type::POINTER:
         result.push_back(makeNULLCheck(left));
         result.push_back(makeNonNULLCheck(left));
-        for (auto &right : components) {
-          if (right.type == Type::POINTER && left.rawType == right.rawType) {
+        for (unsigned long j = i + 1; j < components.size(); j++) {
+          const Expression &right = components[j];
+          if (comparablePair(left, right)) {
             result.push_back(applyBoolOperator(Operator::EQ, left, right));
             result.push_back(applyBoolOperator(Operator::NEQ, left, right));
           }
@@ -250,8 +282,9 @@ namespace synthesis {
         result.push_back(applyBoolOperator(Operator::LE, left, PARAMETER_NODE));
         result.push_back(applyBoolOperator(Operator::GT, left, PARAMETER_NODE));
         result.push_back(applyBoolOperator(Operator::GE, left, PARAMETER_NODE));
-        for (auto &right : components) {
-          if (right.type == Type::INTEGER) {
+        for (unsigned long j = i + 1; j < components.size(); j++) {
+          const Expression &right = components[j];
+          if (comparablePair(left, right)) {
             result.push_back(applyBoolOperator(Operator::EQ, left, right));
             result.push_back(applyBoolOperator(Operator::NEQ, left, right));
             result.push_back(applyBoolOperator(Operator::LT, left, right));
@@ -268,6 +301,54 @@ namespace synthesis {
     return result;
   }
 
+  bool containsComponent(const Expression &expression, const Expression &component) {
+    if (expression.args.empty())
+      return expression.kind == component.kind && expression.repr == component.repr;
+    for (auto &arg : expression.args) {
+      if (containsComponent(arg, component))
+        return true;
+    }
+    return false;
+  }
+
+  /*
+    Components used for synthesis at a location: redundant components are excluded and the rest
+    are ranked (components of the original expression, then variables, then other lvalues; ties
+    are broken by the order of collection, i.e. closer scopes first) and bounded by cfg.maxComponents.
+    All components are still passed to the runtime.
+   */
+  vector<Expression> synthesisComponents(shared_ptr<SchemaApplication> sa) {
+    vector<pair<unsigned, Expression>> ranked;
+    for (auto &c : sa->components) {
+      if (std::find(sa->redundantComponents.begin(), sa->redundantComponents.end(), c.repr) != sa->redundantComponents.end())
+        continue;
+      unsigned score = 0;
+      if (containsComponent(sa->original, c))
+        score += 2;
+      if (c.kind == NodeKind::VARIABLE)
+        score += 1;
+      ranked.push_back(make_pair(score, c));
+    }
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [](const pair<unsigned, Expression> &a, const pair<unsigned, Expression> &b) {
+                       return a.first > b.first;
+                     });
+    if (ranked.size() > cfg.maxComponents)
+      ranked.resize(cfg.maxComponents);
+
+    //NOTE: the order of collection is preserved to keep candidate ids stable
+    vector<Expression> result;
+    for (auto &c : sa->components) {
+      for (auto &r : ranked) {
+        if (r.second.repr == c.repr) {
+          result.push_back(c);
+          break;
+        }
+      }
+    }
+    return result;
+  }
+
   unsigned long substitutionDistance(const Expression &from, const Expression &to) {
     return expressionDepth(from) + expressionDepth(to) - 1;
   }
@@ -375,6 +456,75 @@ namespace synthesis {
     return result;
   }
 
+  bool isCommutative(const Operator &op) {
+    switch (op) {
+    case Operator::EQ:
+    case Operator::NEQ:
+    case Operator::ADD:
+    case Operator::MUL:
+    case Operator::BV_AND:
+    case Operator::BV_OR:
+    case Operator::BV_XOR:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  // structural representation that is identical for equivalent expressions
+  string canonicalForm(const Expression &expression) {
+    if (expression.args.empty()) {
+      return std::to_string(static_cast<int>(expression.kind)) + ":" + expression.rawType + ":" + expression.repr;
+    }
+    Operator op = expression.op;
+    vector<string> args;
+    for (auto &arg : expression.args) {
+      args.push_back(canonicalForm(arg));
+    }
+    if (op == Operator::GT || op == Operator::GE) {
+      op = (op == Operator::GT) ? Operator::LT : Operator::LE;
+      std::swap(args[0], args[1]);
+    }
+    if (isCommutative(op)) {
+      std::sort(args.begin(), args.end());
+    }
+    string result = "(" + std::to_string(static_cast<int>(op));
+    for (auto &arg : args) {
+      result += " " + arg;
+    }
+    return result + ")";
+  }
+
+  /*
+    Removes base modifications that are equivalent to the original expression or to a cheaper
+    modification, and orders the remaining ones by cost, so that their instances are enumerated
+    cheapest first. Holes are compared by their kind, so equivalent modifications have equivalent instances.
+   */
+  vector<pair<Expression, PatchMetadata>>
+  distinctModifications(shared_ptr<SchemaApplication> sa,
+                        const vector<pair<Expression, PatchMetadata>> &modifications,
+                        unsigned long &removed) {
+    vector<double> cost;
+    vector<unsigned long> order;
+    for (unsigned long i = 0; i < modifications.size(); i++) {
+      cost.push_back(syntacticDiff(Patch{PatchID{0}, sa, modifications[i].first, modifications[i].second}));
+      order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](unsigned long a, unsigned long b) { return cost[a] < cost[b]; });
+
+    unordered_set<string> seen{ canonicalForm(sa->original) };
+    vector<pair<Expression, PatchMetadata>> result;
+    for (auto i : order) {
+      if (seen.insert(canonicalForm(modifications[i].first)).second) {
+        result.push_back(modifications[i]);
+      } else {
+        removed++;
+      }
+    }
+    return result;
+  }
+
   vector<pair<Expression, PatchMetadata>> baseModifications(const TransformationSchema &schema,
                                                             const Expression &expr,
                                                             const vector<Expression> &components) {
@@ -419,6 +569,7 @@ namespace generator {
   const string POINTER_ARG_NAME = "__ptr_vals";
   const string SIZES_ARG_NAME = "__ptr_sizes";
   const string NULLDEREF_ARG_NAME = "__nullderef";
+  const string ORIGINAL_ARG_NAME = "__f1x_original";
 
   void substituteWithRuntimeRepr(Expression &expression,
                                  unordered_map<string, string> &runtimeReprBySource) {
@@ -448,6 +599,64 @@ namespace generator {
     return "__" + result + "_vals";
   }
 
+  // NOTE: the project is compiled with -fsanitize-coverage=trace-pc, so every basic block calls
+  // __sanitizer_cov_trace_pc; PCs are made relative to their module to be stable under ASLR
+  void coverageCollector(std::ostream &OUT) {
+    const unsigned maxModules = 64;
+    OUT << "#include <link.h>" << "\n"
+        << "struct __f1x_module_t {" << "\n"
+        << "unsigned long begin;" << "\n"
+        << "unsigned long end;" << "\n"
+        << "unsigned long base;" << "\n"
+        << "};" << "\n"
+        << "__f1x_module_t __f1x_modules[" << maxModules << "];" << "\n"
+        << "int __f1x_module_count = 0;" << "\n"
+        << "unsigned char *__f1x_coverage = NULL;" << "\n"
+        << "unsigned char __f1x_coverage_dummy[" << COVERAGE_MAP_SIZE << "];" << "\n"
+        << "__thread unsigned long __f1x_prev_edge = 0;" << "\n";
+
+    OUT << "int __f1x_collect_module(struct dl_phdr_info *info, size_t size, void *data) {" << "\n"
+        << "for (int i = 0; i < info->dlpi_phnum; i++) {" << "\n"
+        << "if (info->dlpi_phdr[i].p_type == PT_LOAD && (info->dlpi_phdr[i].p_flags & PF_X)"
+        << " && __f1x_module_count < " << maxModules << ") {" << "\n"
+        << "__f1x_modules[__f1x_module_count].base = info->dlpi_addr;" << "\n"
+        << "__f1x_modules[__f1x_module_count].begin = info->dlpi_addr + info->dlpi_phdr[i].p_vaddr;" << "\n"
+        << "__f1x_modules[__f1x_module_count].end = __f1x_modules[__f1x_module_count].begin"
+        << " + info->dlpi_phdr[i].p_memsz;" << "\n"
+        << "__f1x_module_count++;" << "\n"
+        << "}" << "\n"
+        << "}" << "\n"
+        << "return 0;" << "\n"
+        << "}" << "\n";
+
+    OUT << "void __f1x_init_coverage() {" << "\n"
+        << "dl_iterate_phdr(__f1x_collect_module, NULL);" << "\n"
+        << "int fd = shm_open(\"" << sharedMemoryName(COVERAGE_FILE_NAME)
+        << "\", O_RDWR, 0);" << "\n"
+        << "if (fd != -1) {" << "\n"
+        << "void *memory = mmap(NULL, " << COVERAGE_MAP_SIZE << ", PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);" << "\n"
+        << "close(fd);" << "\n"
+        << "if (memory != MAP_FAILED) __f1x_coverage = (unsigned char*) memory;" << "\n"
+        << "}" << "\n"
+        << "if (__f1x_coverage == NULL) __f1x_coverage = __f1x_coverage_dummy;" << "\n"
+        << "}" << "\n";
+
+    OUT << "extern \"C\" void __sanitizer_cov_trace_pc() {" << "\n"
+        << "unsigned long pc = (unsigned long) __builtin_return_address(0);" << "\n"
+        << "if (__f1x_coverage == NULL) __f1x_init_coverage();" << "\n"
+        << "unsigned long location = pc;" << "\n"
+        << "for (int i = 0; i < __f1x_module_count; i++) {" << "\n"
+        << "if (pc >= __f1x_modules[i].begin && pc < __f1x_modules[i].end) {" << "\n"
+        << "location = (pc - __f1x_modules[i].base) ^ ((unsigned long) i << 48);" << "\n"
+        << "break;" << "\n"
+        << "}" << "\n"
+        << "}" << "\n"
+        << "unsigned long current = (location * 0x9E3779B97F4A7C15ul) >> 48;" << "\n"
+        << "__f1x_coverage[(current ^ __f1x_prev_edge) & " << (COVERAGE_MAP_SIZE - 1) << "] = 1;" << "\n"
+        << "__f1x_prev_edge = current >> 1;" << "\n"
+        << "}" << "\n";
+  }
+
   void runtimeLoader(std::ostream &OUT) {
     OUT << "struct __f1xid_t {" << "\n"
         << ID_TYPE << " base;" << "\n"
@@ -465,25 +674,152 @@ namespace generator {
         << ID_TYPE << " __f1xid_param = strtoul(getenv(\"F1X_ID_PARAM\"), (char **)NULL, 10);" << "\n"
         << "__f1xid_t *__f1xids = NULL;" << "\n";
 
+    //NOTE: slots are claimed per thread, and again in a forked child
+    OUT << "struct __f1x_partition_t {" << "\n"
+        << "unsigned long count;" << "\n"
+        << "unsigned long slots;" << "\n"
+        << "unsigned long overflow;" << "\n"
+        << "};" << "\n"
+        << "struct __f1x_slot_t {" << "\n"
+        << "unsigned long count;" << "\n"
+        << "unsigned long hits;" << "\n"
+        << "unsigned long busy;" << "\n"
+        << "};" << "\n"
+        << "__f1x_partition_t *__f1x_partition = NULL;" << "\n"
+        << "__f1x_slot_t *__f1x_slots = NULL;" << "\n"
+        << "unsigned *__f1x_slot_indexes = NULL;" << "\n"
+        << "bool __f1x_runtime_initialized = false;" << "\n"
+        << "__thread bool __f1x_slot_claimed = false;" << "\n"
+        << "__thread __f1x_slot_t *__f1x_slot = NULL;" << "\n"
+        << "__thread unsigned *__f1x_slot_ids = NULL;" << "\n";
+
+    //NOTE: angelic mode also needs all locations to call the runtime
+    OUT << ID_TYPE << " __f1xshadow = (getenv(\"F1X_SHADOW\") || getenv(\"F1X_ANGELIC\")) ? 1 : 0;" << "\n"
+        << "unsigned char *__f1x_shadow = NULL;" << "\n"
+        << "bool __f1x_shadow_initialized = false;" << "\n";
+
+    OUT << ID_TYPE << " __f1xangelic = getenv(\"F1X_ANGELIC\") ? "
+        << "strtoul(getenv(\"F1X_ANGELIC\"), (char **)NULL, 10) : 0;" << "\n"
+        << "const char *__f1x_angelic_prefix = getenv(\"F1X_ANGELIC_PREFIX\");" << "\n"
+        << "unsigned char *__f1x_angelic = NULL;" << "\n"
+        << "bool __f1x_angelic_initialized = false;" << "\n";
+
+    OUT << ID_TYPE << " __f1x_hit_limit = getenv(\"F1X_HIT_LIMIT\") ? "
+        << "strtoul(getenv(\"F1X_HIT_LIMIT\"), (char **)NULL, 10) : 0;" << "\n"
+        << ID_TYPE << " __f1x_hits = 0;" << "\n";
+
+    OUT << "void __f1x_reset_slot() {" << "\n"
+        << "__f1x_slot_claimed = false;" << "\n"
+        << "__f1x_slot = NULL;" << "\n"
+        << "}" << "\n";
+
+    OUT << "void __f1x_claim_slot() {" << "\n"
+        << "__f1x_slot_claimed = true;" << "\n"
+        << "unsigned long slot = __sync_fetch_and_add(&__f1x_partition->slots, 1);" << "\n"
+        << "if (slot >= " << MAX_PARTITION_SLOTS << "ul) {" << "\n"
+        << "__f1x_partition->overflow = 1;" << "\n"
+        << "return;" << "\n"
+        << "}" << "\n"
+        << "__f1x_slot = __f1x_slots + slot;" << "\n"
+        << "__f1x_slot_ids = __f1x_slot_indexes + slot * __f1x_partition->count;" << "\n"
+        << "}" << "\n";
+
+    OUT << "void __f1x_watchdog() {" << "\n"
+        << "int fd = open(\"" << (fs::path(cfg.dataDir) / WATCHDOG_FILE_NAME).string()
+        << "\", O_CREAT | O_WRONLY, S_IRUSR | S_IWUSR);" << "\n"
+        << "if (fd != -1) close(fd);" << "\n"
+        << "_exit(" << WATCHDOG_EXIT_CODE << ");" << "\n"
+        << "}" << "\n";
+
+    //NOTE: threads may initialize concurrently, which only maps the segment more than once
     OUT << "void __f1x_init_runtime() {" << "\n";
     if (cfg.valueTEQ) {
-      OUT << "int fd = shm_open(\"" << PARTITION_FILE_NAME << "_" << geteuid()
-          << "\", O_RDWR, 0);"
-          << "\n"
-          << "struct stat sb;"
-          << "\n"
-          << "fstat(fd, &sb);"
-          << "\n"
-          << "__f1xids = (__f1xid_t*) mmap(NULL, sb.st_size, PROT_READ | "
-             "PROT_WRITE, MAP_SHARED, fd, 0);"
-          << "\n"
-          << "close(fd);"
-          << "\n";
+      OUT << "int fd = shm_open(\"" << sharedMemoryName(PARTITION_FILE_NAME)
+          << "\", O_RDWR, 0);" << "\n"
+          << "void *memory = MAP_FAILED;" << "\n"
+          << "if (fd != -1) {" << "\n"
+          << "struct stat sb;" << "\n"
+          << "fstat(fd, &sb);" << "\n"
+          << "memory = mmap(NULL, sb.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);" << "\n"
+          << "close(fd);" << "\n"
+          << "}" << "\n"
+          << "if (memory != MAP_FAILED) {" << "\n"
+          << "__f1x_partition = (__f1x_partition_t*) memory;" << "\n"
+          << "__f1x_slots = (__f1x_slot_t*) ((__f1xid_t*) (__f1x_partition + 1) + " << MAX_PARTITION_SIZE << "ul);" << "\n"
+          << "__f1x_slot_indexes = (unsigned*) (__f1x_slots + " << MAX_PARTITION_SLOTS << "ul);" << "\n"
+          << "__f1xids = (__f1xid_t*) (__f1x_partition + 1);" << "\n"
+          << "pthread_atfork(NULL, NULL, __f1x_reset_slot);" << "\n"
+          << "}" << "\n";
+    }
+    OUT << "__atomic_store_n(&__f1x_runtime_initialized, true, __ATOMIC_RELEASE);" << "\n"
+        << "}" << "\n";
+
+    OUT << "void __f1x_init_shadow() {" << "\n"
+        << "__f1x_shadow_initialized = true;" << "\n"
+        << "int fd = shm_open(\"" << sharedMemoryName(SHADOW_FILE_NAME)
+        << "\", O_RDWR, 0);" << "\n"
+        << "if (fd == -1) return;" << "\n"
+        << "void *memory = mmap(NULL, " << MAX_SHADOW_SIZE << ", PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);" << "\n"
+        << "close(fd);" << "\n"
+        << "if (memory != MAP_FAILED) __f1x_shadow = (unsigned char*) memory;" << "\n"
+        << "}" << "\n";
+
+    OUT << "bool __f1x_angelic_value(bool original) {" << "\n"
+        << "static unsigned long prefix_length = __f1x_angelic_prefix ? strlen(__f1x_angelic_prefix) : 0;" << "\n"
+        << "static unsigned long hits = 0;" << "\n"
+        << "if (!__f1x_angelic_initialized) {" << "\n"
+        << "__f1x_angelic_initialized = true;" << "\n"
+        << "int fd = shm_open(\"" << sharedMemoryName(ANGELIC_FILE_NAME)
+        << "\", O_RDWR, 0);" << "\n"
+        << "if (fd != -1) {" << "\n"
+        << "void *memory = mmap(NULL, sizeof(unsigned long) + " << MAX_ANGELIC_HITS
+        << ", PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);" << "\n"
+        << "close(fd);" << "\n"
+        << "if (memory != MAP_FAILED) __f1x_angelic = (unsigned char*) memory;" << "\n"
+        << "}" << "\n"
+        << "}" << "\n"
+        << "if (__f1x_hit_limit && hits >= __f1x_hit_limit) __f1x_watchdog();" << "\n"
+        << "bool value = (hits < prefix_length) ? (__f1x_angelic_prefix[hits] == '1') : original;" << "\n"
+        << "if (__f1x_angelic && hits < " << MAX_ANGELIC_HITS << ") "
+        << "__f1x_angelic[sizeof(unsigned long) + hits] = value;" << "\n"
+        << "hits++;" << "\n"
+        << "if (__f1x_angelic) *((unsigned long*) __f1x_angelic) = hits;" << "\n"
+        << "return value;" << "\n"
+        << "}" << "\n";
+
+    if (cfg.dependencyTEQ) {
+      OUT << "unsigned long *__f1x_dependency = NULL;" << "\n"
+          << "bool __f1x_dependency_initialized = false;" << "\n"
+          << "void __f1x_record_dependency(unsigned long used) {" << "\n"
+          << "if (!__f1x_dependency_initialized) {" << "\n"
+          << "__f1x_dependency_initialized = true;" << "\n"
+          << "int fd = shm_open(\"" << sharedMemoryName(DEPENDENCY_FILE_NAME)
+          << "\", O_RDWR, 0);" << "\n"
+          << "if (fd != -1) {" << "\n"
+          << "void *memory = mmap(NULL, sizeof(unsigned long), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);" << "\n"
+          << "close(fd);" << "\n"
+          << "if (memory != MAP_FAILED) __f1x_dependency = (unsigned long*) memory;" << "\n"
+          << "}" << "\n"
+          << "}" << "\n"
+          << "if (__f1x_dependency) __sync_fetch_and_or(__f1x_dependency, used);" << "\n"
+          << "}" << "\n";
+    }
+
+    if (cfg.patchPrioritization == PatchPrioritization::SEMANTIC_DIFF) {
+      coverageCollector(OUT);
     }
-    OUT << "}" << "\n";
   }
 
 
+  string outputTypeOf(shared_ptr<SchemaApplication> sa) {
+    if (sa->original.type == Type::POINTER) {
+      return "void*";
+    } else {
+      return sa->original.rawType;
+    }
+  }
+
+  //NOTE: the last parameter is the value of the original expression (truth value in conditions)
   string parameterList(shared_ptr<SchemaApplication> sa) {
     std::ostringstream result;
 
@@ -530,6 +866,10 @@ namespace generator {
       }
       result << "int " << NULLDEREF_ARG_NAME << "[]";
     }
+    if (!firstArray) {
+      result << ", ";
+    }
+    result << outputTypeOf(sa) << " " << ORIGINAL_ARG_NAME;
   
     return result.str();
   }
@@ -677,7 +1017,11 @@ namespace generator {
       return result.str();
     } else {
       if (expression.args.size() == 0) {
-        if (expression.kind == NodeKind::DEREFERENCE) {
+        if (cfg.dependencyTEQ && expression.kind == NodeKind::PARAMETER) {
+          return "(use_hole(" + to_string(DEPENDS_ON_PARAM) + "ul), " + expression.repr + ")";
+        } else if (cfg.dependencyTEQ && expression.kind == NodeKind::BOOL2) {
+          return expression.repr + "()";
+        } else if (expression.kind == NodeKind::DEREFERENCE) {
           
           std::ostringstream result;
           result << "(" << nullDerefByName[expression.repr]
@@ -707,41 +1051,71 @@ namespace generator {
   }
 
   void candidateDispatch(shared_ptr<SchemaApplication> sa,
-                                unsigned long &baseId,
-                                std::ostream &OS,
-                                vector<Patch> &ss) {
+                         const vector<Expression> &components,
+                         const vector<pair<Expression, PatchMetadata>> &baseModifications,
+                         unsigned long baseId,
+                         std::ostream &OS,
+                         vector<Patch> &ss,
+                         unsigned long &removed) {
     unordered_map<string, string> runtimeReprBySource = runtimeRenaming(sa);
     unordered_map<string, string> sizeByType = typeSizes(sa);
     unordered_map<string, string> nullDerefByName = nullDerefCondition(sa, runtimeReprBySource);
 
-    unsigned long paramBound;
-    if (sa->context == LocationContext::CONDITION) {
-      paramBound = cfg.maxConditionParameter;
-    } else {
-      paramBound = cfg.maxExpressionParameter;
+    vector<unsigned long> parameters = sa->parameterDomain;
+    if (parameters.empty()) {
+      unsigned long paramBound;
+      if (sa->context == LocationContext::CONDITION) {
+        paramBound = cfg.maxConditionParameter;
+      } else {
+        paramBound = cfg.maxExpressionParameter;
+      }
+      for (unsigned long i = 0; i <= paramBound; i++) {
+        parameters.push_back(i);
+      }
     }
 
     OS << "param_value = id.param;" << "\n";
 
+    //NOTE: in dependency mode, BOOL2 is evaluated on demand to record whether the candidate depends on it
+    if (cfg.dependencyTEQ) {
+      OS << "auto bool2_value = [&]() -> bool {" << "\n"
+         << "use_hole(" << DEPENDS_ON_BOOL2 << "ul);" << "\n";
+    }
     OS << "switch (id.bool2) {" << "\n"
        << "case 0:" << "\n"
        << "break;" << "\n";
     vector<Expression> bool2Expressions =
-      synthesis::bool2Expressions(sa->components);
+      synthesis::bool2Expressions(components);
     for (int i = 0; i < bool2Expressions.size(); i++) {
       Expression runtimeExpr = bool2Expressions[i];
       substituteWithRuntimeRepr(runtimeExpr, runtimeReprBySource);
-      OS << "case " << (i + 1) << ":" << "\n" // 0 means disabled
-         << "bool2_value = " << runtimeSemantics(runtimeExpr, sizeByType, nullDerefByName) << ";" << "\n"
-         << "break;" << "\n";
+      OS << "case " << (i + 1) << ":" << "\n"; // 0 means disabled
+      if (cfg.dependencyTEQ) {
+        OS << "return " << runtimeSemantics(runtimeExpr, sizeByType, nullDerefByName) << ";" << "\n";
+      } else {
+        OS << "bool2_value = " << runtimeSemantics(runtimeExpr, sizeByType, nullDerefByName) << ";" << "\n"
+           << "break;" << "\n";
+      }
     }
     OS << "}" << "\n";
-
-    vector<pair<Expression, PatchMetadata>> baseModifications =
-      synthesis::baseModifications(sa->schema, sa->original, sa->components);
+    if (cfg.dependencyTEQ) {
+      OS << "return false;" << "\n"
+         << "};" << "\n";
+    }
 
     OS << "switch (id.base) {" << "\n";
 
+    //NOTE: instances of different modifications can coincide (e.g. "x > y || B" and "y < x || B");
+    //      modifications are ordered by cost, so the first instance is the cheapest
+    unordered_set<string> instances{ synthesis::canonicalForm(sa->original) };
+    auto addInstance = [&](const PatchID &id, const Expression &instance, const PatchMetadata &metadata) {
+      if (instances.insert(synthesis::canonicalForm(instance)).second) {
+        ss.push_back(Patch{id, sa, instance, metadata});
+      } else {
+        removed++;
+      }
+    };
+
     for (auto &candidate : baseModifications) {
       Expression runtimeExpr = candidate.first;
       PatchMetadata metadata = candidate.second;
@@ -769,15 +1143,22 @@ namespace generator {
             parametrizedCandidates.push(std::make_pair(instanceId, instance));
           }
         } else if (hasNodeOfKind(current.second, NodeKind::PARAMETER)) {
-          for (int i = 0; i <= paramBound; i++) {
+          for (auto value : parameters) {
             PatchID instanceId = current.first;
-            instanceId.param = i;
+            instanceId.param = value;
             Expression instance = current.second;
-            substituteNodeOfKind(instance, NodeKind::PARAMETER, makeIntegerConst(i));
-            ss.push_back(Patch{instanceId, sa, instance, metadata});
+            //NOTE: the type of param_value in the runtime
+            Expression parameter = Expression{ NodeKind::CONSTANT,
+                                               Type::INTEGER,
+                                               Operator::NONE,
+                                               PARAMETER_TYPE,
+                                               to_string(value),
+                                               {} };
+            substituteNodeOfKind(instance, NodeKind::PARAMETER, parameter);
+            addInstance(instanceId, instance, metadata);
           }
         } else {
-          ss.push_back(Patch{current.first, sa, current.second, metadata});
+          addInstance(current.first, current.second, metadata);
         }
       }
       
@@ -787,99 +1168,261 @@ namespace generator {
     OS << "}" << "\n";
   }
 
-  void partitioningFunctions(const vector<shared_ptr<SchemaApplication>> &schemaApplications,
-                             std::ostream &OS,
-                             vector<Patch> &searchSpace) {
+  void locationFunction(shared_ptr<SchemaApplication> sa,
+                        const string &dispatch,
+                        const vector<Patch> &candidates,
+                        unsigned long shadowOffset,
+                        std::ostream &OS) {
+    string outputType = outputTypeOf(sa);
+    string suffix = locationNameSuffix(sa->location);
+
+    unsigned long shadowSize = candidates.size();
+    bool shadowed = shadowSize > 0 && shadowOffset + shadowSize <= MAX_SHADOW_SIZE;
+
+    if (shadowed) {
+      OS << "__f1xid_t __f1x_shadow_ids_" << suffix << "[] = {" << "\n";
+      for (auto &candidate : candidates) {
+        const PatchID &id = candidate.id;
+        OS << "{" << id.base << ", " << id.int2 << ", " << id.bool2 << ", "
+           << id.cond3 << ", " << id.param << "}," << "\n";
+      }
+      OS << "};" << "\n";
+      //NOTE: candidates never converge again, so the diverged prefix is skipped
+      OS << "unsigned long __f1x_shadow_start_" << suffix << " = 0;" << "\n";
+    }
 
-    OS << "#include \"rt.h\"" << "\n"
-       << "#include <stdlib.h>" << "\n"
-       << "#include <vector>" << "\n"
-       << "#include <cstddef>" << "\n"
-       << "#include <unistd.h>" << "\n"
-       << "#include <fcntl.h>" << "\n"
-       << "#include <sys/stat.h>" << "\n"
-       << "#include <sys/mman.h>" << "\n";
+    OS << outputType << " __f1x_"
+       << locationNameSuffix(sa->location)
+       << "(" << generator::parameterList(sa) << ")"
+       << "{" << "\n";
+
+    OS << "__f1xid_t id;" << "\n"
+       << "id.base = __f1xid_base;" << "\n"
+       << "id.int2 = __f1xid_int2;" << "\n"
+       << "id.bool2 = __f1xid_bool2;" << "\n"
+       << "id.cond3 = __f1xid_cond3;" << "\n"
+       << "id.param = __f1xid_param;" << "\n";
+
+    OS << outputType << " base_value;" << "\n"
+       << EXPLICIT_INT_CAST_TYPE << " int2_value;" << "\n"
+       << "bool cond3_value;" << "\n"
+       << PARAMETER_TYPE << " param_value;" << "\n";
+    if (cfg.dependencyTEQ) {
+      OS << "unsigned long used_holes = 0;" << "\n";
+    } else {
+      OS << "bool bool2_value;" << "\n";
+    }
 
+    OS << outputType << " output_value = 0;" << "\n"
+       << "bool output_initialized = false;" << "\n"
+       << "unsigned long input_index = 0;" << "\n"
+       << "unsigned long output_index = 0;" << "\n"
+       << "bool output_panic = false;" << "\n"
+       << "bool current_panic = false;" << "\n"
+       << "unsigned long shadow_index = 0;" << "\n";
+    //NOTE: a hole is recorded before it is evaluated, since its evaluation can crash the program;
+    //      only the evaluation of the active candidate is recorded, not of its partition or in shadow mode
+    if (cfg.dependencyTEQ) {
+      OS << "auto use_hole = [&](unsigned long hole) -> void {" << "\n"
+         << "if (used_holes & hole) return;" << "\n"
+         << "used_holes |= hole;" << "\n"
+         << "if (__f1xapp == " << sa->id << "ul && input_index == 0) __f1x_record_dependency(hole);" << "\n"
+         << "};" << "\n";
+    }
+    if (cfg.valueTEQ) {
+      OS << "__f1x_slot_t *slot = NULL;" << "\n"
+         << "bool first_hit = false;" << "\n"
+         << "unsigned long input_count = 0;" << "\n"
+         << "unsigned candidate_index = 0;" << "\n";
+    }
 
-    generator::runtimeLoader(OS);
+    // shadow mode: another location (or none) is active
+    OS << "if (__f1xapp != " << sa->id << "ul) {" << "\n";
+    OS << "if (__f1xangelic) {" << "\n";
+    if (sa->context == LocationContext::CONDITION) {
+      OS << "if (__f1xangelic == " << sa->id << "ul) "
+         << "return (" << outputType << ") __f1x_angelic_value(" << ORIGINAL_ARG_NAME << " != 0);" << "\n";
+    }
+    OS << "return " << ORIGINAL_ARG_NAME << ";" << "\n"
+       << "}" << "\n";
+    if (shadowed) {
+      OS << "if (!__f1x_shadow_initialized) __f1x_init_shadow();" << "\n"
+         << "if (__f1x_shadow) {" << "\n"
+         << "while (__f1x_shadow_start_" << suffix << " < " << shadowSize << "ul && "
+         << "__f1x_shadow[" << shadowOffset << "ul + __f1x_shadow_start_" << suffix << "]) "
+         << "__f1x_shadow_start_" << suffix << "++;" << "\n"
+         << "shadow_index = __f1x_shadow_start_" << suffix << ";" << "\n"
+         << "goto shadow_" << suffix << ";" << "\n"
+         << "}" << "\n";
+    }
+    OS << "return " << ORIGINAL_ARG_NAME << ";" << "\n"
+       << "}" << "\n";
 
-    unsigned long baseId = 1; // because 0 is reserved:
+    OS << "if (__f1x_hit_limit && __sync_add_and_fetch(&__f1x_hits, 1) > __f1x_hit_limit) __f1x_watchdog();" << "\n";
 
-    for (auto sa : schemaApplications) {
-      string outputType;
-      if (sa->original.type == Type::POINTER) {
-        outputType= "void*";
-      } else {
-        outputType = sa->original.rawType;
-      }
+    //NOTE: the first hit in a slot iterates over all candidates, later hits over the agreeing ones
+    if (cfg.valueTEQ) {
+      OS << "if (!__atomic_load_n(&__f1x_runtime_initialized, __ATOMIC_ACQUIRE)) __f1x_init_runtime();" << "\n"
+         << "if (__f1xids) {" << "\n"
+         << "if (!__f1x_slot_claimed) __f1x_claim_slot();" << "\n"
+         << "slot = __f1x_slot;" << "\n"
+         << "}" << "\n"
+         << "if (slot) {" << "\n"
+         << "slot->busy = 1;" << "\n"
+         << "first_hit = (slot->hits == 0);" << "\n"
+         << "slot->hits++;" << "\n"
+         << "input_count = first_hit ? __f1x_partition->count : slot->count;" << "\n"
+         << "}" << "\n";
+    }
 
-      OS << outputType << " __f1x_"
-         << locationNameSuffix(sa->location)
-         << "(" << generator::parameterList(sa) << ")"
-         << "{" << "\n";
-
-      OS << "__f1xid_t id;" << "\n"
-         << "id.base = __f1xid_base;" << "\n"
-         << "id.int2 = __f1xid_int2;" << "\n"
-         << "id.bool2 = __f1xid_bool2;" << "\n"
-         << "id.cond3 = __f1xid_cond3;" << "\n"
-         << "id.param = __f1xid_param;" << "\n";
-
-      OS << outputType << " base_value;" << "\n"
-         << EXPLICIT_INT_CAST_TYPE << " int2_value;" << "\n"
-         << "bool bool2_value;" << "\n"
-         << "bool cond3_value;" << "\n"
-         << PARAMETER_TYPE << " param_value;" << "\n";
-
-      OS << outputType << " output_value = 0;" << "\n"
-         << "bool output_initialized = false;" << "\n"
-         << "unsigned long input_index = 0;" << "\n"
-         << "unsigned long output_index = 0;" << "\n"
-         << "bool output_panic = false;" << "\n"
-         << "bool current_panic = false;" << "\n";
-
-      if (cfg.valueTEQ) {
-        OS << "if (__f1xids == NULL) __f1x_init_runtime();" << "\n";
-      }
+    OS << "label_" << locationNameSuffix(sa->location) << ":" << "\n";
 
-      OS << "label_" << locationNameSuffix(sa->location) << ":" << "\n";
+    OS << "current_panic = false;" << "\n";
+    if (cfg.dependencyTEQ) {
+      OS << "used_holes = 0;" << "\n";
+    }
 
-      OS << "current_panic = false;" << "\n";
+    //NOTE: the dispatch is a block, so that jumps to the shadow label do not cross its declarations
+    OS << "{" << "\n"
+       << dispatch
+       << "}" << "\n";
 
-      generator::candidateDispatch(sa, baseId, OS, searchSpace);
-      
-      OS << "if (!output_initialized) {" << "\n"
-         << "output_panic = current_panic;" << "\n"
-         << "output_value = base_value;" << "\n"
-         << "output_initialized = true;" << "\n"
-         << "} else if ((output_panic && current_panic)"
-         << " || (!output_panic && !current_panic && output_value == base_value)) {" << "\n";
-      if (cfg.valueTEQ) {
-        OS << "__f1xids[output_index] = id;" << "\n"
-           << "output_index++;" << "\n";
+    if (shadowed) {
+      string diverged;
+      if (sa->context == LocationContext::CONDITION) {
+        diverged = "(base_value != 0) != (" + ORIGINAL_ARG_NAME + " != 0)";
+      } else {
+        diverged = "base_value != " + ORIGINAL_ARG_NAME;
       }
-      OS << "}" << "\n";
+      OS << "if (__f1xapp != " << sa->id << "ul) {" << "\n"
+         << "if (current_panic || " << diverged << ") "
+         << "__f1x_shadow[" << shadowOffset << "ul + shadow_index] = 1;" << "\n"
+         << "shadow_index++;" << "\n"
+         << "goto shadow_" << suffix << ";" << "\n"
+         << "}" << "\n";
+    }
+    
+    OS << "if (!output_initialized) {" << "\n"
+       << "output_panic = current_panic;" << "\n"
+       << "output_value = base_value;" << "\n"
+       << "output_initialized = true;" << "\n"
+       << "} else if ((output_panic && current_panic)"
+       << " || (!output_panic && !current_panic && output_value == base_value)) {" << "\n";
+    if (cfg.valueTEQ) {
+      OS << "__f1x_slot_ids[output_index] = candidate_index;" << "\n"
+         << "output_index++;" << "\n";
+    }
+    OS << "}" << "\n";
 
-      OS << "if (__f1xids && __f1xids[input_index].base != 0) {" << "\n"
-         << "id = __f1xids[input_index];" << "\n"
+    //NOTE: agreeing candidates are compacted in place, so the next hit evaluates only them
+    if (cfg.valueTEQ) {
+      OS << "if (slot && input_index < input_count) {" << "\n"
+         << "candidate_index = first_hit ? input_index : __f1x_slot_ids[input_index];" << "\n"
+         << "id = __f1xids[candidate_index];" << "\n"
          << "input_index++;" << "\n"
          << "goto " << "label_" << locationNameSuffix(sa->location) << ";" << "\n"
          << "}" << "\n";
 
-      if (cfg.valueTEQ) {
-        // output terminator:
-        OS << "__f1xids[output_index] = __f1xid_t{0, 0, 0, 0, 1};" << "\n";
-      }
-
-      OS << "if (output_panic) {" << "\n"
-         << "abort();" << "\n"
+      OS << "if (slot) {" << "\n"
+         << "slot->count = output_index;" << "\n"
+         << "slot->busy = 0;" << "\n"
          << "}" << "\n";
+    }
+
+    OS << "if (output_panic) {" << "\n"
+       << "abort();" << "\n"
+       << "}" << "\n";
+
+    OS << "return output_value;" << "\n";
+
+    if (shadowed) {
+      OS << "shadow_" << suffix << ":" << "\n"
+         << "while (shadow_index < " << shadowSize << "ul && "
+         << "__f1x_shadow[" << shadowOffset << "ul + shadow_index]) shadow_index++;" << "\n"
+         << "if (shadow_index < " << shadowSize << "ul) {" << "\n"
+         << "id = __f1x_shadow_ids_" << suffix << "[shadow_index];" << "\n"
+         << "goto label_" << suffix << ";" << "\n"
+         << "}" << "\n"
+         << "return " << ORIGINAL_ARG_NAME << ";" << "\n";
+    }
+
+    OS << "}" << "\n";
+  }
+
+  void partitioningFunctions(const vector<shared_ptr<SchemaApplication>> &schemaApplications,
+                             std::ostream &OS,
+                             vector<Patch> &searchSpace,
+                             unordered_map<AppID, unsigned long> &duplicates) {
+
+    OS << "#include \"rt.h\"" << "\n"
+       << "#include <stdlib.h>" << "\n"
+       << "#include <string.h>" << "\n"
+       << "#include <vector>" << "\n"
+       << "#include <cstddef>" << "\n"
+       << "#include <unistd.h>" << "\n"
+       << "#include <pthread.h>" << "\n"
+       << "#include <fcntl.h>" << "\n"
+       << "#include <sys/stat.h>" << "\n"
+       << "#include <sys/mman.h>" << "\n";
 
-      OS << "return output_value;" << "\n";
 
-      OS << "}" << "\n";
+    generator::runtimeLoader(OS);
+
+    unsigned long count = schemaApplications.size();
+
+    vector<vector<Expression>> components(count);
+    vector<vector<pair<Expression, PatchMetadata>>> baseModifications(count);
+    vector<unsigned long> removed(count, 0);
+    //NOTE: equivalent modifications are removed before ids are assigned, so they are never emitted
+    parallelFor(count, [&](unsigned long i) {
+        auto sa = schemaApplications[i];
+        components[i] = synthesis::synthesisComponents(sa);
+        baseModifications[i] =
+          synthesis::distinctModifications(sa,
+                                           synthesis::baseModifications(sa->schema, sa->original, components[i]),
+                                           removed[i]);
+      });
+
+    //NOTE: id ranges are pre-assigned, so that ids are the same as in serial generation
+    vector<unsigned long> firstBaseIds(count);
+    unsigned long baseId = 1; // because 0 is reserved:
+    for (unsigned long i = 0; i < count; i++) {
+      firstBaseIds[i] = baseId;
+      baseId += baseModifications[i].size();
+    }
+
+    vector<string> dispatches(count);
+    vector<vector<Patch>> candidates(count);
+    parallelFor(count, [&](unsigned long i) {
+        std::ostringstream dispatch;
+        generator::candidateDispatch(schemaApplications[i], components[i], baseModifications[i],
+                                     firstBaseIds[i], dispatch, candidates[i], removed[i]);
+        dispatches[i] = dispatch.str();
+      });
+
+    vector<unsigned long> shadowOffsets(count);
+    unsigned long total = searchSpace.size();
+    for (unsigned long i = 0; i < count; i++) {
+      shadowOffsets[i] = total;
+      total += candidates[i].size();
     }
 
+    vector<string> functions(count);
+    parallelFor(count, [&](unsigned long i) {
+        std::ostringstream function;
+        generator::locationFunction(schemaApplications[i], dispatches[i], candidates[i], shadowOffsets[i], function);
+        functions[i] = function.str();
+        dispatches[i].clear();
+      });
+
+    searchSpace.reserve(total);
+    for (unsigned long i = 0; i < count; i++) {
+      duplicates[schemaApplications[i]->id] += removed[i];
+      OS << functions[i];
+      searchSpace.insert(searchSpace.end(),
+                         std::make_move_iterator(candidates[i].begin()),
+                         std::make_move_iterator(candidates[i].end()));
+    }
   }
 
 }
@@ -888,22 +1431,19 @@ namespace generator {
 vector<Patch> 
 generateSearchSpace(const vector<shared_ptr<SchemaApplication>> &schemaApplications,
                     std::ostream &OS,
-                    std::ostream &OH) {
+                    std::ostream &OH,
+                    unordered_map<AppID, unsigned long> &duplicates) {
   
   // header
 
   OH << "#ifdef __cplusplus" << "\n"
      << "extern \"C\" {" << "\n"
      << "#endif" << "\n"
-     << "extern " << ID_TYPE << " __f1xapp;" << "\n";
+     << "extern " << ID_TYPE << " __f1xapp;" << "\n"
+     << "extern " << ID_TYPE << " __f1xshadow;" << "\n";
 
   for (auto sa : schemaApplications) {
-    string outputType;
-    if (sa->original.type == Type::POINTER) {
-      outputType= "void*";
-    } else {
-      outputType = sa->original.rawType;
-    }
+    string outputType = generator::outputTypeOf(sa);
 
     OH << outputType << " __f1x_" 
        << generator::locationNameSuffix(sa->location)
@@ -919,7 +1459,7 @@ generateSearchSpace(const vector<shared_ptr<SchemaApplication>> &schemaApplicati
 
   vector<Patch> searchSpace;
   
-  generator::partitioningFunctions(schemaApplications, OS, searchSpace);  
+  generator::partitioningFunctions(schemaApplications, OS, searchSpace, duplicates);  
 
   return searchSpace;
 }
@@ -17,6 +17,7 @@
 */
 
 #include <memory>
+#include <unordered_map>
 
 #include <boost/filesystem.hpp>
 
@@ -44,7 +45,15 @@
   append || A (&& A) = depth(A) 
  */
 
+/*
+  Candidates are compared modulo commutativity of ==, !=, +, *, &, |, ^ and
+  the symmetry of < and >, <= and >= (both operands are always evaluated by the runtime).
+  For each location, only the cheapest candidate of each equivalence class is generated, and
+  candidates equivalent to the original expression are not generated; their numbers are
+  added to duplicates.
+ */
 std::vector<Patch>
 generateSearchSpace(const std::vector<std::shared_ptr<SchemaApplication>> &schemaApplications,
                     std::ostream &OS,
-                    std::ostream &OH);
+                    std::ostream &OH,
+                    std::unordered_map<AppID, unsigned long> &duplicates);
@@ -0,0 +1,174 @@
+/*
+  This file is part of f1x.
+  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+
+  f1x is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+#include "TestScheduler.h"
+#include "Global.h"
+
+using std::vector;
+
+
+// number of pseudo-executions given to the prior when estimating rejection rates, mean times and
+// timeout rates; the global statistics of a test are the prior of its statistics at a location
+const double GLOBAL_PRIOR_WEIGHT = 2.0;
+const double LOCAL_PRIOR_WEIGHT = 4.0;
+
+// initial guess for tests that fail/pass on the original program
+const double FAILING_REJECTION_PRIOR = 0.9;
+const double PASSING_REJECTION_PRIOR = 0.1;
+
+const double MIN_EXPECTED_TIME = 1.0;
+
+// adaptive timeout is TIMEOUT_FACTOR * (time on the original program with runtime) + TIMEOUT_FLOOR
+const unsigned long TIMEOUT_FACTOR = 10;
+const unsigned long TIMEOUT_FLOOR = 500; // milliseconds
+
+
+TestScheduler::TestScheduler(unsigned numTests, unsigned long timeout):
+  timeout(timeout),
+  versions(numTests, 0),
+  global(numTests, TestRecord{0, 0, 0, 0}),
+  profileTime(numTests, 0),
+  profilePassing(numTests, true),
+  baselineTime(numTests, 0),
+  hasBaseline(numTests, false) {}
+
+
+void TestScheduler::recordProfile(unsigned testIndex, TestStatus status, unsigned long time) {
+  profileTime[testIndex] = time;
+  profilePassing[testIndex] = (status == TestStatus::PASS);
+  versions[testIndex]++;
+}
+
+
+void TestScheduler::recordBaseline(unsigned testIndex, unsigned long time) {
+  baselineTime[testIndex] = time;
+  hasBaseline[testIndex] = true;
+}
+
+
+void TestScheduler::record(const Location &location, unsigned testIndex, TestStatus status, unsigned long time) {
+  for (TestRecord *record : { &global[testIndex], &local[location][testIndex] }) {
+    record->executions++;
+    if (status != TestStatus::PASS)
+      record->rejections++;
+    if (status == TestStatus::TIMEOUT)
+      record->timeouts++;
+    else
+      record->nonTimeoutTime += time;
+  }
+  versions[testIndex]++;
+}
+
+
+double TestScheduler::rejectionRate(const TestRecord &record, double prior, double weight) {
+  return (record.rejections + weight * prior) / (record.executions + weight);
+}
+
+
+double TestScheduler::meanTime(const TestRecord &record, double prior, double weight) {
+  return (record.nonTimeoutTime + weight * prior) / (record.executions - record.timeouts + weight);
+}
+
+
+double TestScheduler::timeoutRate(const TestRecord &record, double prior, double weight) {
+  return (record.timeouts + weight * prior) / (record.executions + weight);
+}
+
+
+//NOTE: globally, the profiling run counts as one non-timeout execution
+double TestScheduler::expectedTime(const TestRecord &localRecord, unsigned testIndex) {
+  double globalTime = meanTime(global[testIndex], profileTime[testIndex], 1.0);
+  double globalTimeoutRate = timeoutRate(global[testIndex], 0.0, 1.0);
+  double localTime = meanTime(localRecord, globalTime, LOCAL_PRIOR_WEIGHT);
+  double localTimeoutRate = timeoutRate(localRecord, globalTimeoutRate, LOCAL_PRIOR_WEIGHT);
+  double result = (1.0 - localTimeoutRate) * localTime + localTimeoutRate * timeout;
+  return std::max(result, MIN_EXPECTED_TIME);
+}
+
+
+double TestScheduler::score(const Location &location, unsigned testIndex) {
+  double prior = profilePassing[testIndex] ? PASSING_REJECTION_PRIOR : FAILING_REJECTION_PRIOR;
+  double globalRate = rejectionRate(global[testIndex], prior, GLOBAL_PRIOR_WEIGHT);
+  TestRecord localRecord = {0, 0, 0, 0};
+  auto locationRecords = local.find(location);
+  if (locationRecords != local.end() && locationRecords->second.count(testIndex))
+    localRecord = locationRecords->second[testIndex];
+  double localRate = rejectionRate(localRecord, globalRate, LOCAL_PRIOR_WEIGHT);
+  return localRate / expectedTime(localRecord, testIndex);
+}
+
+
+//NOTE: a score depends only on the records of its test, so only the scores of tests recorded since
+// the last query are recomputed, and the tests are sorted again only if their order changed
+const vector<unsigned> &TestScheduler::order(const Location &location, const vector<unsigned> &tests) {
+  auto cached = cachedOrder.find(location);
+  if (cached == cachedOrder.end()) {
+    TestOrder &result = cachedOrder[location];
+    result.tests = tests;
+    for (auto testIndex : tests) {
+      result.scores.push_back(score(location, testIndex));
+      result.versions.push_back(versions[testIndex]);
+    }
+    cached = cachedOrder.find(location);
+  } else {
+    TestOrder &result = cached->second;
+    bool sorted = true;
+    for (unsigned i = 0; i < result.tests.size(); i++) {
+      unsigned testIndex = result.tests[i];
+      if (result.versions[i] != versions[testIndex]) {
+        result.scores[i] = score(location, testIndex);
+        result.versions[i] = versions[testIndex];
+      }
+      if (i > 0 && result.scores[i - 1] < result.scores[i])
+        sorted = false;
+    }
+    if (sorted)
+      return result.tests;
+  }
+
+  TestOrder &result = cached->second;
+  vector<unsigned> positions;
+  for (unsigned i = 0; i < result.tests.size(); i++) {
+    positions.push_back(i);
+  }
+  //NOTE: stable sort preserves the previous order (initially, the profile order) for equal scores
+  std::stable_sort(positions.begin(), positions.end(),
+                   [&result](unsigned a, unsigned b) {
+                     return result.scores[a] > result.scores[b];
+                   });
+
+  TestOrder reordered;
+  for (auto position : positions) {
+    reordered.tests.push_back(result.tests[position]);
+    reordered.scores.push_back(result.scores[position]);
+    reordered.versions.push_back(result.versions[position]);
+  }
+  result = reordered;
+  return result.tests;
+}
+
+
+//NOTE: the profiled time is not used, since the profiling build is lighter than the runtime build;
+// tests without a baseline, e.g. that time out on the original program, keep the global timeout
+unsigned long TestScheduler::getTimeout(unsigned testIndex) {
+  if (!cfg.adaptiveTimeout || !hasBaseline[testIndex])
+    return timeout;
+  return std::min(timeout, TIMEOUT_FACTOR * baselineTime[testIndex] + TIMEOUT_FLOOR);
+}
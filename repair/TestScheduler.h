@@ -0,0 +1,75 @@
+/*
+  This file is part of f1x.
+  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+
+  f1x is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+
+#include "Core.h"
+#include "Util.h"
+
+
+struct TestRecord {
+  unsigned long executions;
+  unsigned long rejections;
+  unsigned long timeouts;
+  unsigned long nonTimeoutTime; // milliseconds
+};
+
+
+// order of tests of a location with the scores and record versions it was computed from
+struct TestOrder {
+  std::vector<unsigned> tests;
+  std::vector<double> scores;
+  std::vector<unsigned long> versions;
+};
+
+
+/*
+  Orders tests of each candidate by the expected number of rejections per unit of time,
+  so that cheap and highly discriminating tests are executed first. Rejection rates, mean
+  times and timeout rates are collected globally and per location; the global ones serve
+  as a prior for locations with few executions.
+ */
+class TestScheduler {
+ public:
+  TestScheduler(unsigned numTests, unsigned long timeout);
+  void recordProfile(unsigned testIndex, TestStatus status, unsigned long time);
+  void recordBaseline(unsigned testIndex, unsigned long time);
+  void record(const Location &location, unsigned testIndex, TestStatus status, unsigned long time);
+  const std::vector<unsigned> &order(const Location &location, const std::vector<unsigned> &tests);
+  unsigned long getTimeout(unsigned testIndex);
+
+ private:
+  double rejectionRate(const TestRecord &record, double prior, double weight);
+  double meanTime(const TestRecord &record, double prior, double weight);
+  double timeoutRate(const TestRecord &record, double prior, double weight);
+  double expectedTime(const TestRecord &localRecord, unsigned testIndex);
+  double score(const Location &location, unsigned testIndex);
+
+  unsigned long timeout;
+  std::vector<unsigned long> versions; // by test, incremented when its records change
+  std::vector<TestRecord> global;
+  std::vector<unsigned long> profileTime;
+  std::vector<bool> profilePassing;
+  std::vector<unsigned long> baselineTime; // of the original program built with the runtime
+  std::vector<bool> hasBaseline;
+  std::unordered_map<Location, std::unordered_map<unsigned, TestRecord>> local;
+  std::unordered_map<Location, TestOrder> cachedOrder;
+};
@@ -0,0 +1,135 @@
+/*
+  This file is part of f1x.
+  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+
+  f1x is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+#include "TraceStore.h"
+
+using std::vector;
+
+
+// NOTE: without a target flag such as -mpopcnt, __builtin_popcountl is a call into libgcc
+static unsigned long hammingDistance(const unsigned long *first,
+                                     const unsigned long *second,
+                                     std::size_t size) {
+  unsigned long result = 0;
+  for (std::size_t i = 0; i < size; i++) {
+    result += __builtin_popcountl(first[i] ^ second[i]);
+  }
+  return result;
+}
+
+
+TraceStore::TraceStore(unsigned numTests):
+  original(numTests),
+  hasOriginal(numTests, false),
+  patchDistances(numTests),
+  internedCounter(0) {}
+
+
+TraceID TraceStore::intern(const CoverageBitmap &trace) {
+  std::size_t hash = 0;
+  for (auto word : trace) {
+    hash_combine(hash, word);
+  }
+  auto candidates = tracesByHash.find(hash);
+  if (candidates != tracesByHash.end()) {
+    for (auto id : candidates->second) {
+      if (traces[id] == trace)
+        return id;
+    }
+  }
+  if (traces.size() >= MAX_STORED_TRACES) {
+    traces.clear();
+    tracesByHash.clear();
+    distanceCache.clear();
+  }
+  TraceID id = traces.size();
+  traces.push_back(trace);
+  tracesByHash[hash].push_back(id);
+  internedCounter++;
+  return id;
+}
+
+
+void TraceStore::setOriginal(unsigned testIndex, TraceID trace) {
+  original[testIndex] = traces[trace];
+  hasOriginal[testIndex] = true;
+}
+
+
+unsigned TraceStore::distance(TraceID trace, unsigned testIndex) {
+  unsigned long key = ((unsigned long) trace << 32) | testIndex;
+  auto cached = distanceCache.find(key);
+  if (cached != distanceCache.end())
+    return cached->second;
+  const CoverageBitmap &a = traces[trace];
+  const CoverageBitmap &b = original[testIndex];
+  unsigned result = hammingDistance(a.data(), b.data(), std::min(a.size(), b.size()));
+  distanceCache[key] = result;
+  return result;
+}
+
+
+void TraceStore::assign(unsigned testIndex, const PatchID &id, TraceID trace) {
+  if (hasOriginal[testIndex])
+    patchDistances[testIndex][id] = distance(trace, testIndex);
+}
+
+
+bool TraceStore::getDistance(unsigned testIndex, const PatchID &id, unsigned &distance) {
+  auto found = patchDistances[testIndex].find(id);
+  if (found == patchDistances[testIndex].end())
+    return false;
+  distance = found->second;
+  return true;
+}
+
+
+void TraceStore::setDistance(unsigned testIndex, const PatchID &id, unsigned distance) {
+  patchDistances[testIndex][id] = distance;
+}
+
+
+const vector<std::unordered_map<PatchID, unsigned>> &TraceStore::getDistances() {
+  return patchDistances;
+}
+
+
+//NOTE: passes inferred without execution (e.g. by value replay or from the outcome table) have no
+// trace, so distances are averaged over traced tests to compare patches with different coverage
+double TraceStore::distanceToOriginal(const PatchID &id) {
+  unsigned long result = 0;
+  unsigned traced = 0;
+  for (unsigned test = 0; test < patchDistances.size(); test++) {
+    auto distance = patchDistances[test].find(id);
+    if (distance != patchDistances[test].end()) {
+      result += distance->second;
+      traced++;
+    }
+  }
+  if (traced == 0)
+    return UNTRACED_DISTANCE;
+  return (double) result / traced;
+}
+
+
+//NOTE: traces that were dropped and interned again are counted again
+unsigned long TraceStore::size() {
+  return internedCounter;
+}
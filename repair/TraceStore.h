@@ -0,0 +1,74 @@
+/*
+  This file is part of f1x.
+  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+
+  f1x is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <limits>
+
+#include "Core.h"
+#include "Util.h"
+#include "Runtime.h"
+
+
+typedef unsigned TraceID;
+
+
+// maximum number of distinct bitmaps kept for deduplication (COVERAGE_MAP_SIZE bits each)
+const unsigned long MAX_STORED_TRACES = 4096;
+
+// distance of patches without traced tests, which are ranked after traced ones
+const double UNTRACED_DISTANCE = std::numeric_limits<double>::max();
+
+
+/*
+  Execution traces (coverage bitmaps) are hash-consed: executions with identical traces
+  share a single bitmap and its distances to the original traces. (test, patch) pairs only
+  store the distance of their trace to the original trace of the test, so bitmaps are not
+  needed after an execution is recorded. When MAX_STORED_TRACES bitmaps are stored, they are
+  dropped together with the cached distances between bitmaps; the distances of (test, patch) pairs
+  are kept, which bounds memory by the number of passing pairs.
+  Only traces of passing executions are recorded, since only plausible patches are ranked.
+ */
+class TraceStore {
+ public:
+  TraceStore(unsigned numTests);
+
+  //NOTE: identifiers are valid until the next call of intern
+  TraceID intern(const CoverageBitmap &trace);
+  void setOriginal(unsigned testIndex, TraceID trace);
+  void assign(unsigned testIndex, const PatchID &id, TraceID trace);
+  //NOTE: distances computed by another process (a worker, or a previous run) are imported directly
+  bool getDistance(unsigned testIndex, const PatchID &id, unsigned &distance);
+  void setDistance(unsigned testIndex, const PatchID &id, unsigned distance);
+  const std::vector<std::unordered_map<PatchID, unsigned>> &getDistances();
+  double distanceToOriginal(const PatchID &id);
+  unsigned long size();
+
+ private:
+  std::vector<CoverageBitmap> traces;
+  std::unordered_map<std::size_t, std::vector<TraceID>> tracesByHash;
+  std::vector<CoverageBitmap> original;
+  std::vector<bool> hasOriginal;
+  std::vector<std::unordered_map<PatchID, unsigned>> patchDistances;
+  std::unordered_map<unsigned long, unsigned> distanceCache; // by trace and test
+  unsigned long internedCounter;
+
+  unsigned distance(TraceID trace, unsigned testIndex);
+};
@@ -21,17 +21,27 @@
 #include <memory>
 #include <cstdlib>
 #include <string>
+#include <cstring>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 #include <boost/filesystem/fstream.hpp>
 
 #include <rapidjson/document.h>
-#include <rapidjson/istreamwrapper.h>
 
 #include "Util.h"
+#include "Global.h"
 #include "Config.h"
 #include "Typing.h"
+#include "ExchangeFormat.h"
 
 namespace fs = boost::filesystem;
 namespace json = rapidjson;
@@ -435,14 +445,10 @@ Expression convertExpression(const json::Value &json) {
   return Expression{kind, type, op, rawType, repr, args};
 }
 
-vector<shared_ptr<SchemaApplication>> loadSAFile(const fs::path &path) {
+vector<shared_ptr<SchemaApplication>> loadJSONSAFile(const char *data, size_t size) {
   vector<shared_ptr<SchemaApplication>> result;
   json::Document d;
-  {
-    fs::ifstream ifs(path);
-    json::IStreamWrapper isw(ifs);
-    d.ParseStream(isw);
-  }
+  d.Parse(data, size);
 
   for (auto &app : d.GetArray()) {
     unsigned long appId = app["appId"].GetUint();
@@ -484,13 +490,23 @@ vector<shared_ptr<SchemaApplication>> loadSAFile(const fs::path &path) {
 
     std::stable_sort(completePointeeTypes.begin(), completePointeeTypes.end());
 
+    vector<unsigned long> literals;
+    if (app.HasMember("literals")) {
+      for (auto &l : app["literals"].GetArray()) {
+        literals.push_back(l.GetUint64());
+      }
+    }
+
     shared_ptr<SchemaApplication> sa(new SchemaApplication{ appId,
                                                             schema,
                                                             location,
                                                             context,
                                                             expression,
                                                             components,
-                                                            completePointeeTypes });
+                                                            completePointeeTypes,
+                                                            literals,
+                                                            {},
+                                                            {} });
     result.push_back(sa);
   }
 
@@ -498,6 +514,283 @@ vector<shared_ptr<SchemaApplication>> loadSAFile(const fs::path &path) {
 }
 
 
+
+namespace {
+
+/*
+  Sequential reader of a memory-mapped file in the binary exchange format
+ */
+class ExchangeReader {
+public:
+  ExchangeReader(const char *begin, const char *end): cursor(begin), end(end) {}
+
+  template<typename T>
+  T get() {
+    T value;
+    std::memcpy(&value, take(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  const char *take(size_t length) {
+    if (length > (size_t) (end - cursor))
+      throw parse_error("truncated schema applications file");
+    const char *data = cursor;
+    cursor += length;
+    return data;
+  }
+
+private:
+  const char *cursor;
+  const char *end;
+};
+
+Operator convertOperator(exchange::Operator op) {
+  switch (op) {
+  case exchange::Operator::NONE: return Operator::NONE;
+  case exchange::Operator::EQ: return Operator::EQ;
+  case exchange::Operator::NEQ: return Operator::NEQ;
+  case exchange::Operator::LT: return Operator::LT;
+  case exchange::Operator::LE: return Operator::LE;
+  case exchange::Operator::GT: return Operator::GT;
+  case exchange::Operator::GE: return Operator::GE;
+  case exchange::Operator::OR: return Operator::OR;
+  case exchange::Operator::AND: return Operator::AND;
+  case exchange::Operator::ADD: return Operator::ADD;
+  case exchange::Operator::SUB: return Operator::SUB;
+  case exchange::Operator::MUL: return Operator::MUL;
+  case exchange::Operator::DIV: return Operator::DIV;
+  case exchange::Operator::MOD: return Operator::MOD;
+  case exchange::Operator::NEG: return Operator::NEG;
+  case exchange::Operator::NOT: return Operator::NOT;
+  case exchange::Operator::BV_AND: return Operator::BV_AND;
+  case exchange::Operator::BV_XOR: return Operator::BV_XOR;
+  case exchange::Operator::BV_OR: return Operator::BV_OR;
+  case exchange::Operator::BV_SHL: return Operator::BV_SHL;
+  case exchange::Operator::BV_SHR: return Operator::BV_SHR;
+  case exchange::Operator::BV_NOT: return Operator::BV_NOT;
+  case exchange::Operator::PTR_ADD: return Operator::PTR_ADD;
+  case exchange::Operator::PTR_SUB: return Operator::PTR_SUB;
+  default:
+    throw parse_error("unsupported operator code: " + std::to_string((unsigned) op));
+  }
+}
+
+NodeKind convertKind(exchange::Kind kind) {
+  switch (kind) {
+  case exchange::Kind::OPERATOR: return NodeKind::OPERATOR;
+  case exchange::Kind::VARIABLE: return NodeKind::VARIABLE;
+  case exchange::Kind::DEREFERENCE: return NodeKind::DEREFERENCE;
+  case exchange::Kind::CONSTANT: return NodeKind::CONSTANT;
+  default:
+    throw parse_error("unsupported kind code: " + std::to_string((unsigned) kind));
+  }
+}
+
+const string &stringAt(const vector<string> &strings, uint32_t index) {
+  if (index >= strings.size())
+    throw parse_error("invalid string index: " + std::to_string(index));
+  return strings[index];
+}
+
+Expression readExpression(ExchangeReader &reader, const vector<string> &strings) {
+  NodeKind kind = convertKind((exchange::Kind) reader.get<uint8_t>());
+  Type approxType = ((exchange::Type) reader.get<uint8_t>() == exchange::Type::POINTER) ? Type::POINTER : Type::INTEGER;
+  Operator op = convertOperator((exchange::Operator) reader.get<uint8_t>());
+  reader.get<uint8_t>(); // flags are only needed for pointee types that are resolved by the transform
+  const string &rawType = stringAt(strings, reader.get<uint32_t>());
+  const string &repr = stringAt(strings, reader.get<uint32_t>());
+  uint32_t arity = reader.get<uint32_t>();
+
+  Type type = approxType;
+  if (arity > 0) {
+    if (kind != NodeKind::OPERATOR || op == Operator::NONE || arity > 2)
+      throw parse_error("unsupported arguments size: " + std::to_string(arity));
+    type = operatorOutputType(op);
+  }
+
+  vector<Expression> args;
+  args.reserve(arity);
+  for (uint32_t i = 0; i < arity; i++) {
+    args.push_back(readExpression(reader, strings));
+  }
+
+  return Expression{kind, type, op, rawType, repr, args};
+}
+
+vector<shared_ptr<SchemaApplication>> loadBinarySAFile(const char *data, size_t size) {
+  vector<shared_ptr<SchemaApplication>> result;
+  ExchangeReader reader(data, data + size);
+
+  reader.take(sizeof(exchange::MAGIC));
+  uint32_t version = reader.get<uint32_t>();
+  if (version != exchange::VERSION)
+    throw parse_error("unsupported schema applications version: " + std::to_string(version));
+  uint32_t stringCount = reader.get<uint32_t>();
+  uint32_t literalCount = reader.get<uint32_t>();
+  uint32_t appCount = reader.get<uint32_t>();
+
+  // strings are interned by the transform, so each of them is constructed once:
+  vector<string> strings;
+  strings.reserve(stringCount);
+  for (uint32_t i = 0; i < stringCount; i++) {
+    uint32_t length = reader.get<uint32_t>();
+    strings.push_back(string(reader.take(length), length));
+  }
+
+  vector<unsigned long> literals;
+  literals.reserve(literalCount);
+  for (uint32_t i = 0; i < literalCount; i++) {
+    literals.push_back(reader.get<uint64_t>());
+  }
+
+  result.reserve(appCount);
+  for (uint32_t i = 0; i < appCount; i++) {
+    unsigned long appId = reader.get<uint64_t>();
+
+    TransformationSchema schema;
+    switch ((exchange::Schema) reader.get<uint8_t>()) {
+    case exchange::Schema::EXPRESSION:
+      schema = TransformationSchema::EXPRESSION;
+      break;
+    case exchange::Schema::IF_GUARD:
+      schema = TransformationSchema::IF_GUARD;
+      break;
+    case exchange::Schema::INITIALIZATION:
+      schema = TransformationSchema::INITIALIZATION;
+      break;
+    default:
+      throw parse_error("unsupported transformation schema code");
+    }
+
+    LocationContext context = LocationContext::UNKNOWN;
+    if ((exchange::Context) reader.get<uint8_t>() == exchange::Context::CONDITION)
+      context = LocationContext::CONDITION;
+
+    Location location;
+    location.fileId = reader.get<uint32_t>();
+    location.beginLine = reader.get<uint32_t>();
+    location.beginColumn = reader.get<uint32_t>();
+    location.endLine = reader.get<uint32_t>();
+    location.endColumn = reader.get<uint32_t>();
+
+    Expression expression = readExpression(reader, strings);
+
+    uint32_t componentCount = reader.get<uint32_t>();
+    vector<Expression> components;
+    components.reserve(componentCount);
+    for (uint32_t c = 0; c < componentCount; c++) {
+      components.push_back(readExpression(reader, strings));
+    }
+
+    // NOTE: complete pointee types are de-duplicated and sorted by the transform
+    uint32_t pointeeTypeCount = reader.get<uint32_t>();
+    vector<string> completePointeeTypes;
+    completePointeeTypes.reserve(pointeeTypeCount);
+    for (uint32_t t = 0; t < pointeeTypeCount; t++) {
+      completePointeeTypes.push_back(stringAt(strings, reader.get<uint32_t>()));
+    }
+
+    shared_ptr<SchemaApplication> sa(new SchemaApplication{ appId,
+                                                            schema,
+                                                            location,
+                                                            context,
+                                                            expression,
+                                                            components,
+                                                            completePointeeTypes,
+                                                            literals,
+                                                            {},
+                                                            {} });
+    result.push_back(sa);
+  }
+
+  return result;
+}
+
+/*
+  Read-only memory mapping of a whole file
+ */
+class MappedFile {
+public:
+  MappedFile(const fs::path &path): data(nullptr), size(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+      throw parse_error("failed to open " + path.string());
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      size = st.st_size;
+      void *mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapped != MAP_FAILED)
+        data = static_cast<const char*>(mapped);
+    }
+    close(fd);
+    if (size > 0 && !data)
+      throw parse_error("failed to map " + path.string());
+  }
+
+  ~MappedFile() {
+    if (data)
+      munmap(const_cast<char*>(data), size);
+  }
+
+  const char *data;
+  size_t size;
+};
+
+}
+
+
+vector<shared_ptr<SchemaApplication>> loadSAFile(const fs::path &path) {
+  MappedFile file(path);
+  //NOTE: JSON files are debug dumps of the transform, they are still accepted
+  if (file.size >= sizeof(exchange::MAGIC) &&
+      std::memcmp(file.data, exchange::MAGIC, sizeof(exchange::MAGIC)) == 0) {
+    return loadBinarySAFile(file.data, file.size);
+  }
+  return loadJSONSAFile(file.data, file.size);
+}
+
+
+void parallelFor(unsigned long count, const std::function<void(unsigned long)> &body) {
+  unsigned long jobs = cfg.jobs ? cfg.jobs : std::thread::hardware_concurrency();
+  jobs = std::min(std::max(jobs, 1ul), count);
+  if (jobs <= 1) {
+    for (unsigned long i = 0; i < count; i++) {
+      body(i);
+    }
+    return;
+  }
+
+  std::atomic<unsigned long> next(0);
+  std::exception_ptr error;
+  std::mutex errorMutex;
+  auto worker = [&]() {
+    unsigned long i;
+    while ((i = next++) < count) {
+      try {
+        body(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!error)
+          error = std::current_exception();
+        next = count;
+      }
+    }
+  };
+
+  vector<std::thread> threads;
+  for (unsigned long t = 1; t < jobs; t++) {
+    threads.push_back(std::thread(worker));
+  }
+  worker();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  if (error)
+    std::rethrow_exception(error);
+}
+
+
 vector<shared_ptr<SchemaApplication>> loadSchemaApplications(const vector<fs::path> &paths) {
   vector<shared_ptr<SchemaApplication>> result;
   for (auto &path : paths) {
@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include <functional>
 #include <unordered_map>
 #include "Config.h"
 #include "Core.h"
@@ -132,6 +133,13 @@ class parse_error : public std::logic_error {
 };
 
 
+/*
+  Calls body(0), ..., body(count - 1) on cfg.jobs threads (all cores if 0).
+  Iterations must be independent; the first exception is rethrown after all threads finish.
+ */
+void parallelFor(unsigned long count, const std::function<void(unsigned long)> &body);
+
+
 std::vector<std::shared_ptr<SchemaApplication>> loadSchemaApplications(const std::vector<boost::filesystem::path> &paths);
 
 
@@ -0,0 +1,528 @@
+/*
+  This file is part of f1x.
+  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+
+  f1x is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include "ValueReplay.h"
+
+using std::vector;
+using std::string;
+using std::unordered_map;
+
+
+namespace {
+
+  struct IntType {
+    unsigned bits;
+    bool isUnsigned;
+  };
+
+  // NOTE: integer values are stored sign- or zero-extended to 64 bits according to their type
+  struct Value {
+    bool pointer;
+    IntType type;
+    unsigned long long bits;
+  };
+
+  const IntType INT_TYPE{32, false};
+  const IntType LONG_TYPE{64, false};
+  const IntType UNSIGNED_TYPE{32, true};
+  const IntType UNSIGNED_LONG_TYPE{64, true};
+
+  // NOTE: assumes LP64 data model and signed char
+  bool intTypeByName(const string &name, IntType &type) {
+    if (name == "char" || name == "signed char") {
+      type = IntType{8, false};
+    } else if (name == "unsigned char") {
+      type = IntType{8, true};
+    } else if (name == "short") {
+      type = IntType{16, false};
+    } else if (name == "unsigned short") {
+      type = IntType{16, true};
+    } else if (name == "int" || name == "wchar_t") {
+      type = INT_TYPE;
+    } else if (name == "unsigned int" || name == "unsigned") {
+      type = UNSIGNED_TYPE;
+    } else if (name == "long" || name == "long long") {
+      type = LONG_TYPE;
+    } else if (name == "unsigned long" || name == "unsigned long long") {
+      type = UNSIGNED_LONG_TYPE;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  unsigned long long normalize(unsigned long long bits, const IntType &type) {
+    if (type.bits >= 64)
+      return bits;
+    unsigned long long mask = (1ull << type.bits) - 1;
+    bits &= mask;
+    if (!type.isUnsigned && ((bits >> (type.bits - 1)) & 1))
+      bits |= ~mask;
+    return bits;
+  }
+
+  Value makeInt(unsigned long long bits, const IntType &type) {
+    return Value{false, type, normalize(bits, type)};
+  }
+
+  Value makePointer(unsigned long long bits) {
+    return Value{true, UNSIGNED_LONG_TYPE, bits};
+  }
+
+  Value makeBool(bool value) {
+    return makeInt(value ? 1 : 0, INT_TYPE);
+  }
+
+  bool truthy(const Value &value) {
+    return value.bits != 0;
+  }
+
+  IntType promote(const IntType &type) {
+    if (type.bits < INT_TYPE.bits)
+      return INT_TYPE;
+    return type;
+  }
+
+  // usual arithmetic conversions
+  IntType commonType(const IntType &first, const IntType &second) {
+    IntType a = promote(first);
+    IntType b = promote(second);
+    if (a.bits == b.bits)
+      return IntType{a.bits, a.isUnsigned || b.isUnsigned};
+    return (a.bits > b.bits) ? a : b;
+  }
+
+  bool fits(__int128 value, const IntType &type) {
+    __int128 max = (((__int128) 1) << (type.bits - 1)) - 1;
+    __int128 min = -max - 1;
+    return value >= min && value <= max;
+  }
+
+  bool parseConstant(const Expression &expression, Value &result) {
+    if (expression.type == Type::POINTER) {
+      if (expression.repr != NULL_NODE.repr)
+        return false;
+      result = makePointer(0);
+      return true;
+    }
+    IntType type;
+    if (!intTypeByName(expression.rawType, type))
+      return false;
+    string repr = expression.repr;
+    if (repr.size() >= 3 && repr.front() == '\'' && repr.back() == '\'') {
+      string body = repr.substr(1, repr.size() - 2);
+      unsigned long long character;
+      if (body.size() == 1 && body != "\\") {
+        character = (unsigned char) body[0];
+      } else if (body == "\\n") {
+        character = '\n';
+      } else if (body == "\\t") {
+        character = '\t';
+      } else if (body == "\\r") {
+        character = '\r';
+      } else if (body == "\\0") {
+        character = '\0';
+      } else if (body == "\\\\" || body == "\\'" || body == "\\\"") {
+        character = (unsigned char) body[1];
+      } else {
+        return false;
+      }
+      result = makeInt(character, type);
+      return true;
+    }
+    while (!repr.empty() && std::strchr("uUlL", repr.back()))
+      repr.pop_back();
+    if (repr.empty() || !std::isdigit(repr[0]))
+      return false; //NOTE: negative constants are represented with NEG
+    errno = 0;
+    char *end;
+    unsigned long long value = std::strtoull(repr.c_str(), &end, 0);
+    if (errno != 0 || *end != '\0')
+      return false;
+    result = makeInt(value, type);
+    return true;
+  }
+
+
+  class Evaluator {
+  public:
+    Evaluator(const unordered_map<string, unsigned long> &indexes,
+              const ValueTrace &trace,
+              unsigned long hit):
+      indexes(indexes),
+      trace(trace),
+      hit(hit) {}
+
+    bool evaluate(const Expression &expression, Value &result) {
+      switch (expression.kind) {
+      case NodeKind::VARIABLE:
+      case NodeKind::DEREFERENCE:
+        return component(expression, result);
+      case NodeKind::CONSTANT:
+        return parseConstant(expression, result);
+      case NodeKind::OPERATOR:
+        return operation(expression, result);
+      default:
+        return false; // abstract nodes are not evaluated
+      }
+    }
+
+  private:
+    const unordered_map<string, unsigned long> &indexes;
+    const ValueTrace &trace;
+    unsigned long hit;
+
+    bool component(const Expression &expression, Value &result) {
+      auto it = indexes.find(expression.repr);
+      if (it == indexes.end() || it->second >= trace.numComponents)
+        return false;
+      unsigned long index = hit * trace.numComponents + it->second;
+      if (!trace.valid[index])
+        return false;
+      unsigned long long bits = (unsigned long long) trace.values[index];
+      if (expression.type == Type::POINTER) {
+        result = makePointer(bits);
+        return true;
+      }
+      IntType type;
+      if (!intTypeByName(expression.rawType, type))
+        return false;
+      result = makeInt(bits, type);
+      return true;
+    }
+
+    bool operation(const Expression &expression, Value &result) {
+      Value left, right;
+      switch (expression.op) {
+      case Operator::IMPLICIT_BV_CAST:
+      case Operator::IMPLICIT_INT_CAST:
+        return evaluate(expression.args[0], result);
+
+      case Operator::EXPLICIT_INT_CAST:
+      case Operator::EXPLICIT_BV_CAST:
+      case Operator::EXPLICIT_UNSIGNED_CAST: {
+        if (!evaluate(expression.args[0], left))
+          return false;
+        IntType type;
+        if (!intTypeByName(expression.rawType, type))
+          return false;
+        result = makeInt(left.bits, type);
+        return true;
+      }
+
+      case Operator::NOT:
+        if (!evaluate(expression.args[0], left))
+          return false;
+        result = makeBool(!truthy(left));
+        return true;
+
+      case Operator::NEG:
+      case Operator::BV_NOT: {
+        if (!evaluate(expression.args[0], left) || left.pointer)
+          return false;
+        IntType type = promote(left.type);
+        Value arg = makeInt(left.bits, type);
+        if (expression.op == Operator::BV_NOT) {
+          result = makeInt(~arg.bits, type);
+          return true;
+        }
+        if (!type.isUnsigned && !fits(-(__int128) (long long) arg.bits, type))
+          return false;
+        result = makeInt(0 - arg.bits, type);
+        return true;
+      }
+
+      case Operator::AND:
+      case Operator::OR:
+        //NOTE: the right argument is not evaluated (and cannot panic) if the left one decides
+        if (!evaluate(expression.args[0], left))
+          return false;
+        if (truthy(left) == (expression.op == Operator::OR)) {
+          result = makeBool(truthy(left));
+          return true;
+        }
+        if (!evaluate(expression.args[1], right))
+          return false;
+        result = makeBool(truthy(right));
+        return true;
+
+      case Operator::EQ:
+      case Operator::NEQ:
+      case Operator::LT:
+      case Operator::LE:
+      case Operator::GT:
+      case Operator::GE:
+        if (!evaluate(expression.args[0], left) || !evaluate(expression.args[1], right))
+          return false;
+        return compare(expression.op, left, right, result);
+
+      case Operator::ADD:
+      case Operator::SUB:
+      case Operator::MUL:
+      case Operator::DIV:
+      case Operator::MOD:
+      case Operator::BV_AND:
+      case Operator::BV_OR:
+      case Operator::BV_XOR:
+        if (!evaluate(expression.args[0], left) || !evaluate(expression.args[1], right))
+          return false;
+        if (left.pointer || right.pointer)
+          return false;
+        return arithmetic(expression.op, left, right, result);
+
+      case Operator::BV_SHL:
+      case Operator::BV_SHR:
+        if (!evaluate(expression.args[0], left) || !evaluate(expression.args[1], right))
+          return false;
+        if (left.pointer || right.pointer)
+          return false;
+        return shift(expression.op, left, right, result);
+
+      default:
+        return false; // pointer arithmetic and casts to pointers
+      }
+    }
+
+    bool compare(Operator op, const Value &left, const Value &right, Value &result) {
+      if (left.pointer != right.pointer)
+        return false;
+      bool isUnsigned = true;
+      unsigned long long a = left.bits;
+      unsigned long long b = right.bits;
+      if (!left.pointer) {
+        IntType type = commonType(left.type, right.type);
+        isUnsigned = type.isUnsigned;
+        a = normalize(a, type);
+        b = normalize(b, type);
+      }
+      bool less = isUnsigned ? (a < b) : ((long long) a < (long long) b);
+      switch (op) {
+      case Operator::EQ:
+        result = makeBool(a == b);
+        break;
+      case Operator::NEQ:
+        result = makeBool(a != b);
+        break;
+      case Operator::LT:
+        result = makeBool(less);
+        break;
+      case Operator::LE:
+        result = makeBool(less || a == b);
+        break;
+      case Operator::GT:
+        result = makeBool(!less && a != b);
+        break;
+      case Operator::GE:
+        result = makeBool(!less);
+        break;
+      default:
+        return false;
+      }
+      return true;
+    }
+
+    bool arithmetic(Operator op, const Value &left, const Value &right, Value &result) {
+      IntType type = commonType(left.type, right.type);
+      unsigned long long a = normalize(left.bits, type);
+      unsigned long long b = normalize(right.bits, type);
+
+      switch (op) {
+      case Operator::BV_AND:
+        result = makeInt(a & b, type);
+        return true;
+      case Operator::BV_OR:
+        result = makeInt(a | b, type);
+        return true;
+      case Operator::BV_XOR:
+        result = makeInt(a ^ b, type);
+        return true;
+      case Operator::DIV:
+      case Operator::MOD:
+        if (b == 0)
+          return false; // the runtime panics
+        break;
+      default:
+        break;
+      }
+
+      if (type.isUnsigned) {
+        unsigned long long value;
+        switch (op) {
+        case Operator::ADD: value = a + b; break;
+        case Operator::SUB: value = a - b; break;
+        case Operator::MUL: value = a * b; break;
+        case Operator::DIV: value = a / b; break;
+        case Operator::MOD: value = a % b; break;
+        default: return false;
+        }
+        result = makeInt(value, type);
+        return true;
+      }
+
+      //NOTE: signed overflow is undefined, so the behaviour of the runtime is unknown
+      __int128 x = (long long) a;
+      __int128 y = (long long) b;
+      __int128 value;
+      switch (op) {
+      case Operator::ADD: value = x + y; break;
+      case Operator::SUB: value = x - y; break;
+      case Operator::MUL: value = x * y; break;
+      case Operator::DIV: value = x / y; break;
+      case Operator::MOD: value = x % y; break;
+      default: return false;
+      }
+      if (!fits(value, type) || ((op == Operator::DIV || op == Operator::MOD) && !fits(x / y, type)))
+        return false;
+      result = makeInt((unsigned long long) value, type);
+      return true;
+    }
+
+    bool shift(Operator op, const Value &left, const Value &right, Value &result) {
+      IntType type = promote(left.type);
+      unsigned long long a = normalize(left.bits, type);
+      IntType countType = promote(right.type);
+      unsigned long long count = normalize(right.bits, countType);
+      if ((!countType.isUnsigned && (long long) count < 0) || count >= type.bits)
+        return false;
+
+      if (op == Operator::BV_SHR) {
+        if (type.isUnsigned)
+          result = makeInt(a >> count, type);
+        else
+          result = makeInt((unsigned long long) ((long long) a >> count), type);
+        return true;
+      }
+
+      if (type.isUnsigned) {
+        result = makeInt(a << count, type);
+        return true;
+      }
+      __int128 value = ((__int128) (long long) a) << count;
+      if ((long long) a < 0 || !fits(value, type))
+        return false;
+      result = makeInt((unsigned long long) value, type);
+      return true;
+    }
+  };
+
+}
+
+
+ValueReplay::ValueReplay(unordered_map<Location, unordered_map<unsigned, ValueTrace>> traces):
+  traces(traces) {}
+
+
+const unordered_map<string, unsigned long> &ValueReplay::indexesOf(const Patch &patch) {
+  if (!componentIndexes.count(patch.app->id)) {
+    unordered_map<string, unsigned long> &indexes = componentIndexes[patch.app->id];
+    for (unsigned long i = 0; i < patch.app->components.size(); i++) {
+      indexes.insert(std::make_pair(patch.app->components[i].repr, i));
+    }
+  }
+  return componentIndexes[patch.app->id];
+}
+
+
+vector<unsigned> ValueReplay::unchangedTests(const Patch &patch) {
+  vector<unsigned> result;
+  auto locationTraces = traces.find(patch.app->location);
+  if (locationTraces == traces.end())
+    return result;
+
+  const unordered_map<string, unsigned long> &indexes = indexesOf(patch);
+
+  //NOTE: the generated function converts the value of candidate to the type of the original expression
+  bool outputPointer = (patch.app->original.type == Type::POINTER);
+  IntType outputType;
+  if (!outputPointer && !intTypeByName(patch.app->original.rawType, outputType))
+    return result;
+  bool condition = (patch.app->context == LocationContext::CONDITION);
+
+  for (auto &entry : locationTraces->second) {
+    const ValueTrace &trace = entry.second;
+    if (trace.numComponents != patch.app->components.size())
+      continue; // profiling instrumentation does not match schema application
+
+    bool unchanged = true;
+    for (unsigned long hit = 0; hit < trace.original.size() && unchanged; hit++) {
+      Evaluator evaluator(indexes, trace, hit);
+      Value value;
+      if (!evaluator.evaluate(patch.modified, value) || value.pointer != outputPointer) {
+        unchanged = false;
+        break;
+      }
+      unsigned long long original = (unsigned long long) trace.original[hit];
+      if (!outputPointer)
+        value = makeInt(value.bits, outputType);
+      if (condition) {
+        unchanged = (truthy(value) == (original != 0));
+      } else if (outputPointer) {
+        unchanged = (value.bits == original);
+      } else {
+        unchanged = (value.bits == makeInt(original, outputType).bits);
+      }
+    }
+    if (unchanged)
+      result.push_back(entry.first);
+  }
+
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+
+bool ValueReplay::divergencePrefix(const Patch &patch, unsigned testIndex, vector<bool> &prefix) {
+  prefix.clear();
+  if (patch.app->context != LocationContext::CONDITION)
+    return false;
+  auto locationTraces = traces.find(patch.app->location);
+  if (locationTraces == traces.end())
+    return false;
+  auto entry = locationTraces->second.find(testIndex);
+  if (entry == locationTraces->second.end())
+    return false;
+  const ValueTrace &trace = entry->second;
+  if (trace.numComponents != patch.app->components.size())
+    return false;
+
+  const unordered_map<string, unsigned long> &indexes = indexesOf(patch);
+  bool outputPointer = (patch.app->original.type == Type::POINTER);
+  IntType outputType;
+  if (!outputPointer && !intTypeByName(patch.app->original.rawType, outputType))
+    return false;
+
+  for (unsigned long hit = 0; hit < trace.original.size(); hit++) {
+    Evaluator evaluator(indexes, trace, hit);
+    Value value;
+    if (!evaluator.evaluate(patch.modified, value) || value.pointer != outputPointer)
+      return false;
+    if (!outputPointer)
+      value = makeInt(value.bits, outputType);
+    bool original = (trace.original[hit] != 0);
+    prefix.push_back(truthy(value));
+    if (truthy(value) != original)
+      return true;
+  }
+  return true;
+}
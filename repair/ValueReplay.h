@@ -0,0 +1,54 @@
+/*
+  This file is part of f1x.
+  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+
+  f1x is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+
+#include "Core.h"
+#include "Util.h"
+#include "Profiler.h"
+
+
+/*
+  Candidates are replayed on component values recorded during profiling. If a candidate
+  produces the value of the original expression at every hit of a location in a test, then
+  the execution of this test is not affected by the candidate, so its outcome is known.
+  The evaluation follows the semantics of the generated runtime; operations whose result
+  is not determined by this semantics (overflow, pointer arithmetic, panics) are unknown.
+ */
+class ValueReplay {
+ public:
+  ValueReplay(std::unordered_map<Location, std::unordered_map<unsigned, ValueTrace>> traces);
+
+  // indexes of tests in which the candidate does not change the original execution
+  std::vector<unsigned> unchangedTests(const Patch &patch);
+
+  // truth values of a condition candidate in a test up to (and including) the first hit where
+  // it differs from the original; returns false if these values cannot be determined
+  bool divergencePrefix(const Patch &patch, unsigned testIndex, std::vector<bool> &prefix);
+
+ private:
+  const std::unordered_map<std::string, unsigned long> &indexesOf(const Patch &patch);
+
+  std::unordered_map<Location, std::unordered_map<unsigned, ValueTrace>> traces;
+  std::unordered_map<AppID, std::unordered_map<std::string, unsigned long>> componentIndexes;
+};
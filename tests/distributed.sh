@@ -0,0 +1,102 @@
+#!/usr/bin/env bash
+
+#  This file is part of f1x.
+#  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+#
+#  f1x is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Runs a coordinator and several local workers on a test and checks that the distributed
+# search produces the same patches as a single process, for each cost function.
+
+require () {
+    hash "$1" 2>/dev/null || { echo "command $1 is not found"; exit 1; }
+}
+
+require f1x
+require make
+
+TEST=${TEST:-if-condition}
+WORKERS=${WORKERS:-3}
+PORT=${PORT:-40123}
+REPAIR_CMD="f1x --files program.c --driver test.sh --tests n1 p1 p2 --test-timeout 1000 --all"
+
+cd "$( dirname "${BASH_SOURCE[0]}" )"
+
+fail () {
+    echo 'FAIL'
+    echo "----------------------------------------"
+    echo "$1"
+    echo "logs: $work_dir"
+    echo "----------------------------------------"
+    exit 1
+}
+
+for cost in syntactic-diff semantic-diff; do
+    echo -n "* testing $TEST with $WORKERS workers and $cost... "
+
+    work_dir=`mktemp -d`
+    repair_cmd="$REPAIR_CMD --cost $cost"
+
+    #NOTE: every process builds the program in its own copy
+    mkdir "$work_dir/local" "$work_dir/coordinator"
+    cp -r "$TEST"/* "$work_dir/local"
+    cp -r "$TEST"/* "$work_dir/coordinator"
+    for i in $(seq 1 $WORKERS); do
+        mkdir "$work_dir/worker$i"
+        cp -r "$TEST"/* "$work_dir/worker$i"
+    done
+
+    (cd "$work_dir/local"; $repair_cmd --output "$work_dir/local.out" --enable-cleanup &> "$work_dir/local.txt")
+    if [[ ($? != 0) || (! -d "$work_dir/local.out") ]]; then
+        fail "local search failed"
+    fi
+
+    (cd "$work_dir/coordinator"; $repair_cmd --coordinate $PORT --output "$work_dir/coordinator.out" --enable-cleanup &> "$work_dir/coordinator.txt") &
+    coordinator=$!
+
+    #NOTE: workers do not retry connecting, so they are started once the coordinator listens
+    until grep -q "coordinating search on port" "$work_dir/coordinator.txt" 2>/dev/null; do
+        if ! kill -0 $coordinator 2>/dev/null; then
+            fail "coordinator terminated before accepting workers"
+        fi
+        sleep 1
+    done
+
+    pids=()
+    for i in $(seq 1 $WORKERS); do
+        (cd "$work_dir/worker$i"; $repair_cmd --worker localhost:$PORT --output "$work_dir/worker$i.out" --enable-cleanup &> "$work_dir/worker$i.txt") &
+        pids+=($!)
+    done
+
+    wait $coordinator
+    status=$?
+    for pid in "${pids[@]}"; do
+        wait $pid
+    done
+    if [[ ($status != 0) || (! -d "$work_dir/coordinator.out") ]]; then
+        fail "distributed search failed"
+    fi
+
+    #NOTE: patches are numbered by rank, so this also compares the ranking
+    if ! diff -r "$work_dir/local.out" "$work_dir/coordinator.out" > "$work_dir/diff.txt"; then
+        fail "distributed search produced different patches: $work_dir/diff.txt"
+    fi
+
+    rm -rf "$work_dir"
+    echo 'PASS'
+done
+
+echo "----------------------------------------"
+echo "f1x passed the distributed tests"
+echo "----------------------------------------"
@@ -0,0 +1,39 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define THREADS 4
+
+struct task {
+  int x;
+  int y;
+  int result;
+};
+
+void *compare(void *data) {
+  struct task *task = data;
+  if (task->x > task->y) { // >=
+    task->result = 0;
+  } else {
+    task->result = 1;
+  }
+  return NULL;
+}
+
+int main(int argc, char *argv[]) {
+  int a, b, i;
+  a = atoi(argv[1]);
+  b = atoi(argv[2]);
+  pthread_t threads[THREADS];
+  struct task tasks[THREADS];
+  for (i = 0; i < THREADS; i++) {
+    tasks[i].x = a + i;
+    tasks[i].y = b;
+    pthread_create(&threads[i], NULL, compare, &tasks[i]);
+  }
+  for (i = 0; i < THREADS; i++) {
+    pthread_join(threads[i], NULL);
+    printf("%d\n", tasks[i].result);
+  }
+  return 0;
+}
@@ -0,0 +1,20 @@
+#!/bin/bash
+
+assert-equal () {
+    diff -q <($1) <(echo -ne "$2") > /dev/null
+}
+
+case "$1" in
+    n1)
+        assert-equal "./program 1 3" '1\n1\n0\n0\n'
+        ;;
+    p1)
+        assert-equal "./program 5 3" '0\n0\n0\n0\n'
+        ;;
+    p2)
+        assert-equal "./program 0 9" '1\n1\n1\n1\n'
+        ;;
+    *)
+        exit 1
+        ;;
+esac
@@ -89,6 +89,9 @@ get-cmd () {
         null-dereference)
             echo "f1x --files program.c:15 --driver test.sh --tests n1 p1 p2 --test-timeout 1000"
             ;;
+        null-dereference-original)
+            echo "f1x --files program.c:13 --driver test.sh --tests n1 n2 n3 --test-timeout 1000"
+            ;;
         incomplete-pointee)
             echo "f1x --files program.c --driver test.sh --tests n1 p1 p2 --test-timeout 1000"
             ;;
@@ -104,6 +107,9 @@ get-cmd () {
         array-element-update)
             echo "f1x --files program.c:9 --driver test.sh --tests n1 n2 p1 --test-timeout 1000"
             ;;
+        multithreaded)
+            echo "f1x --files program.c:15 --driver test.sh --tests n1 p1 p2 --test-timeout 1000"
+            ;;
         signed-int-overflow)
             echo "f1x --files program.c:9 --driver test.sh --tests n1 --test-timeout 1000 --disable-vteq"
             ;;
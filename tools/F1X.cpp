@@ -114,6 +114,8 @@ int main (int argc, char *argv[]) {
     ("test-timeout,T", po::value<unsigned>()->value_name("MS"), "test execution timeout")
     ("files,f", po::value<vector<string>>()->multitoken()->value_name("PATH..."), "list of source files to repair")
     ("localize,l", po::value<unsigned>()->value_name("NUM"), ("number of files to localize (default: " + std::to_string(cfg.filesToLocalize) + ")").c_str())
+    ("max-components", po::value<unsigned>()->value_name("NUM"), ("maximum number of components per location (default: " + std::to_string(cfg.maxComponents) + ")").c_str())
+    ("jobs,j", po::value<unsigned>()->value_name("NUM"), "number of threads for search space generation (default: number of cores)")
     ("build,b", po::value<string>()->value_name("CMD"), ("build command (default: " + buildCmd + ")").c_str())
     ("output,o", po::value<string>()->value_name("PATH"), "output patch file or directory (default: f1x-TIME)")
     ("all,a", "generate all patches")
@@ -122,6 +124,11 @@ int main (int argc, char *argv[]) {
     ("help,h", "produce help message and exit")
     ("version", "print version and exit")
     ("output-stat", po::value<string>()->value_name("PATH"), "output execution statistics")
+    ("outcome-table", po::value<string>()->value_name("PATH"), "share test outcomes with other workers through table file")
+    ("outcome-cache", po::value<string>()->value_name("PATH"), "reuse test outcomes of previous runs stored in cache file")
+    ("coordinate", po::value<unsigned>()->value_name("PORT"), "distribute search to workers connecting to port")
+    ("worker", po::value<string>()->value_name("HOST:PORT"), "search candidates assigned by coordinator")
+    ("resume", po::value<string>()->value_name("DIR"), "resume from checkpoint in intermediate data directory")
     ("output-space", po::value<string>()->value_name("PATH"), "[DEBUG] output search space")
     ("output-one-per-loc", "output single optimal patch per location")
     ("output-top", po::value<unsigned>()->value_name("N"), "find top N patches")
@@ -134,6 +141,11 @@ int main (int argc, char *argv[]) {
     ("disable-vteq", "[DEBUG] don't apply value-based analysis")
     ("disable-dteq", "[DEBUG] don't apply dependency-based analysis")
     ("disable-testprior", "[DEBUG] don't prioritize tests")
+    ("disable-adaptive-timeout", "[DEBUG] use test timeout for all executions")
+    ("disable-replay", "[DEBUG] don't infer test outcomes from profiled values")
+    ("disable-shadow", "[DEBUG] don't evaluate all candidates alongside the original program")
+    ("disable-angelic", "[DEBUG] don't search angelic values of conditions")
+    ("disable-domains", "[DEBUG] don't infer synthesis domains from profiled values")
     ;
 
   po::variables_map vm;
@@ -212,10 +224,34 @@ int main (int argc, char *argv[]) {
     cfg.valueTEQ = false;
   }
 
+  if (vm.count("disable-dteq")) {
+    cfg.dependencyTEQ = false;
+  }
+
   if (vm.count("disable-testprior")) {
     cfg.testPrioritization = TestPrioritization::FIXED_ORDER;
   }
 
+  if (vm.count("disable-adaptive-timeout")) {
+    cfg.adaptiveTimeout = false;
+  }
+
+  if (vm.count("disable-replay")) {
+    cfg.valueReplay = false;
+  }
+
+  if (vm.count("disable-shadow")) {
+    cfg.shadowEvaluation = false;
+  }
+
+  if (vm.count("disable-angelic")) {
+    cfg.angelicSearch = false;
+  }
+
+  if (vm.count("disable-domains")) {
+    cfg.valueDomains = false;
+  }
+
   if (vm.count("disable-guard")) {
     cfg.addGuards = false;
   }
@@ -246,6 +282,39 @@ int main (int argc, char *argv[]) {
     cfg.filesToLocalize = vm["localize"].as<unsigned>();
   }
 
+  if (vm.count("max-components")) {
+    cfg.maxComponents = vm["max-components"].as<unsigned>();
+  }
+
+  if (vm.count("jobs")) {
+    cfg.jobs = vm["jobs"].as<unsigned>();
+  }
+
+  if (vm.count("outcome-table")) {
+    cfg.outcomeTable = fs::absolute(vm["outcome-table"].as<string>()).string();
+  }
+
+  if (vm.count("outcome-cache")) {
+    cfg.outcomeCache = fs::absolute(vm["outcome-cache"].as<string>()).string();
+  }
+
+  if (vm.count("coordinate") && vm.count("worker")) {
+    BOOST_LOG_TRIVIAL(error) << "options --coordinate and --worker are mutually exclusive";
+    return ERROR_EXIT_CODE;
+  }
+
+  if (vm.count("coordinate")) {
+    cfg.coordinatorPort = vm["coordinate"].as<unsigned>();
+    if (cfg.coordinatorPort == 0 || cfg.coordinatorPort > 65535) {
+      BOOST_LOG_TRIVIAL(error) << "invalid coordinator port: " << cfg.coordinatorPort;
+      return ERROR_EXIT_CODE;
+    }
+  }
+
+  if (vm.count("worker")) {
+    cfg.coordinatorAddress = vm["worker"].as<string>();
+  }
+
   if (vm.count("files")) {
     vector<string> fileArgs = vm["files"].as<vector<string>>();
     try {
@@ -281,8 +350,18 @@ int main (int argc, char *argv[]) {
     fs::remove_all(output);
   }
 
-  fs::path dataDir = fs::temp_directory_path() / fs::unique_path();
-  fs::create_directory(dataDir);
+  fs::path dataDir;
+  if (vm.count("resume")) {
+    dataDir = fs::absolute(vm["resume"].as<string>());
+    if (!fs::is_directory(dataDir)) {
+      BOOST_LOG_TRIVIAL(error) << "intermediate data directory " << dataDir << " does not exist";
+      return ERROR_EXIT_CODE;
+    }
+    cfg.resume = true;
+  } else {
+    dataDir = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directory(dataDir);
+  }
   BOOST_LOG_TRIVIAL(info) << "intermediate data directory: " << dataDir;
   cfg.dataDir = dataDir.string();
 
@@ -69,6 +69,9 @@ ToLine("to-line", cl::desc("to line"), cl::cat(F1XCategory));
 static cl::opt<std::string>
 Output("output", cl::desc("output file"), cl::cat(F1XCategory));
 
+static cl::opt<std::string>
+DumpJSON("dump-json", cl::desc("dump schema applications as JSON"), cl::cat(F1XCategory));
+
 
 // Patch application options:
 
@@ -103,6 +106,7 @@ int main(int argc, const char **argv) {
   cfg.toLine = ToLine;
   cfg.profileFile = Instrument;
   cfg.outputFile = Output;
+  cfg.jsonFile = DumpJSON;
   cfg.beginLine = BeginLine;
   cfg.beginColumn = BeginColumn;
   cfg.endLine = EndLine;
@@ -0,0 +1,72 @@
+/*
+  This file is part of f1x.
+  Copyright (C) 2016  Sergey Mechtaev, Gao Xiang, Shin Hwei Tan, Abhik Roychoudhury
+
+  f1x is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+
+/*
+  Binary format of schema applications written by f1x-transform and loaded by f1x.
+
+  All fields are in host byte order and packed without padding:
+    header       magic "F1XA", uint32 version, uint32 string count, uint32 literal count, uint32 application count
+    string       uint32 length, characters (strings are interned and referenced by index)
+    literal      uint64 value (integer literals of the file, shared by all applications)
+    application  uint64 id, uint8 schema, uint8 context, 5 x uint32 location (file id, begin line/column, end line/column),
+                 expression node, uint32 component count, component nodes,
+                 uint32 pointee type count, uint32 string index of each complete pointee type (sorted, unique)
+    node         uint8 kind, uint8 type, uint8 operator, uint8 flags, uint32 raw type string, uint32 repr string,
+                 uint32 argument count, argument nodes
+
+  NOTE: VERSION must be increased on any layout change
+*/
+namespace exchange {
+
+const char MAGIC[4] = { 'F', '1', 'X', 'A' };
+const uint32_t VERSION = 1;
+
+enum class Schema : uint8_t {
+  EXPRESSION, IF_GUARD, INITIALIZATION
+};
+
+enum class Context : uint8_t {
+  UNKNOWN, CONDITION
+};
+
+enum class Kind : uint8_t {
+  OPERATOR, VARIABLE, DEREFERENCE, CONSTANT
+};
+
+enum class Type : uint8_t {
+  INTEGER, POINTER
+};
+
+// operators are resolved by the transform, including pointer arithmetic:
+enum class Operator : uint8_t {
+  NONE,
+  EQ, NEQ, LT, LE, GT, GE, OR, AND, ADD, SUB, MUL, DIV, MOD, NEG, NOT,
+  BV_AND, BV_XOR, BV_OR, BV_SHL, BV_SHR, BV_NOT,
+  PTR_ADD, PTR_SUB,
+  UNSUPPORTED = 0xff
+};
+
+// node flags:
+const uint8_t INCOMPLETE_POINTEE = 1;
+
+}
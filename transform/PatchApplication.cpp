@@ -66,6 +66,7 @@ PatchApplicationASTConsumer::PatchApplicationASTConsumer(Rewriter &R) :
 }
 
 void PatchApplicationASTConsumer::HandleTranslationUnit(ASTContext &Context) {
+  buildRepairabilityIndex(Context);
   Matcher.matchAST(Context);
 }
 
@@ -21,6 +21,8 @@
 #include <iostream>
 #include <unordered_set>
 
+#include <rapidjson/document.h>
+
 #include "Config.h"
 #include "TransformGlobal.h"
 #include "TransformUtil.h"
@@ -30,6 +32,8 @@
 using namespace clang;
 using namespace ast_matchers;
 
+namespace json = rapidjson;
+
 
 /*
   Clang sometimes (for unknown reasons) starts the same file action or matches the same location twice, which causes crashes or invalid results.
@@ -77,6 +81,9 @@ ProfileInstrumentationASTConsumer::ProfileInstrumentationASTConsumer(Rewriter &R
 }
 
 void ProfileInstrumentationASTConsumer::HandleTranslationUnit(ASTContext &Context) {
+  buildRepairabilityIndex(Context);
+  initComponentAnalyses(Context);
+  buildScopeIndex(Context);
   Matcher.matchAST(Context);
 }
 
@@ -115,12 +122,25 @@ void IfGuardSchemaProfileHandler::run(const MatchFinder::MatchResult &Result) {
       if (srcMgr.getMainFileID() != decLoc.first)
         return;
 
+      json::Document document;
+      std::vector<json::Value> components = collectComponents(stmt, beginLine, Result.Context, document.GetAllocator());
+      //NOTE: the original value of guard is 1; the statement itself is not an expression
+      std::string declarations;
+      std::string values = makeValueList(nullptr, components, document.GetAllocator(), declarations);
+
       std::ostringstream replacement;
       replacement << "({ __f1x_trace(" << cfg.fileId << ", "
                                        << beginLine << ", "
                                        << beginColumn << ", "
                                        << endLine << ", "
                                        << endColumn << "); "
+                  << declarations
+                  << "__f1x_values(" << cfg.fileId << ", "
+                                     << beginLine << ", "
+                                     << beginColumn << ", "
+                                     << endLine << ", "
+                                     << endColumn << ", "
+                                     << "1ll, " << values << "); "
                   << toString(stmt) << "; })";
 
       Rewrite.ReplaceText(expandedLoc, replacement.str());
@@ -159,12 +179,25 @@ void ExpressionSchemaProfileHandler::run(const MatchFinder::MatchResult &Result)
     if (srcMgr.getMainFileID() != decLoc.first)
       return;
 
+    json::Document document;
+    std::vector<json::Value> components = collectComponents(expr, beginLine, Result.Context, document.GetAllocator());
+    std::string declarations;
+    std::string values = makeValueList(expr, components, document.GetAllocator(), declarations);
+
+    //NOTE: the expression is evaluated twice, but it is side-effect free
     std::ostringstream stringStream;
     stringStream << "({ __f1x_trace(" << cfg.fileId << ", " 
                                       << beginLine << ", "
                                       << beginColumn << ", " 
                                       << endLine << ", "
                                       << endColumn << "); "
+                 << declarations
+                 << "__f1x_values(" << cfg.fileId << ", "
+                                    << beginLine << ", "
+                                    << beginColumn << ", "
+                                    << endLine << ", "
+                                    << endColumn << ", "
+                                    << "(long long) (" << toString(expr) << "), " << values << "); "
                  << toString(expr) << "; })";
     
     Rewrite.ReplaceText(expandedLoc, stringStream.str());
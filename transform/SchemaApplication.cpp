@@ -25,10 +25,13 @@
 #include <rapidjson/ostreamwrapper.h>
 #include <rapidjson/writer.h>
 #include <map>
+#include <set>
+#include <unordered_map>
 
 #include "Config.h"
 #include "TransformGlobal.h"
 #include "TransformUtil.h"
+#include "ExchangeFormat.h"
 #include "SearchSpaceMatchers.h"
 #include "SchemaApplication.h"
 
@@ -42,30 +45,222 @@ using std::string;
 
 json::Document schemaApplications;
 
-std::unordered_set<std::string> interestingLocations;
+std::unordered_set<Location> interestingLocations;
+
+// integer literals of the main file, they are used as parameter values
+std::set<uint64_t> literals;
 
 void initInterestingLocations() {
   std::ifstream infile(cfg.profileFile);
   std::string line;
   while(std::getline(infile, line)) {
-    interestingLocations.insert(line);
+    std::istringstream fields(line);
+    Location location;
+    if (fields >> location.fileId
+               >> location.beginLine
+               >> location.beginColumn
+               >> location.endLine
+               >> location.endColumn)
+      interestingLocations.insert(location);
   }
 }
 
 bool isInterestingLocation(unsigned fileId, unsigned beginLine, unsigned beginColumn, unsigned endLine, unsigned endColumn) {
-  std::ostringstream location;
-  location << fileId << " "
-           << beginLine << " "
-           << beginColumn << " "
-           << endLine << " "
-           << endColumn;
-
-  if(interestingLocations.find(location.str()) == interestingLocations.end())
-    return false;
+  Location location{ fileId, beginLine, beginColumn, endLine, endColumn };
+  return interestingLocations.count(location) > 0;
+}
 
-  return true;
+namespace {
+
+exchange::Operator resolveOperator(const string &repr, unsigned arity, bool pointer) {
+  static const std::map<string, exchange::Operator> unaryOperators = {
+    { "-", exchange::Operator::NEG },
+    { "!", exchange::Operator::NOT },
+    { "~", exchange::Operator::BV_NOT }
+  };
+  static const std::map<string, exchange::Operator> binaryOperators = {
+    { "==", exchange::Operator::EQ },
+    { "!=", exchange::Operator::NEQ },
+    { "<", exchange::Operator::LT },
+    { "<=", exchange::Operator::LE },
+    { ">", exchange::Operator::GT },
+    { ">=", exchange::Operator::GE },
+    { "||", exchange::Operator::OR },
+    { "&&", exchange::Operator::AND },
+    { "+", exchange::Operator::ADD },
+    { "-", exchange::Operator::SUB },
+    { "*", exchange::Operator::MUL },
+    { "/", exchange::Operator::DIV },
+    { "%", exchange::Operator::MOD },
+    { "&", exchange::Operator::BV_AND },
+    { "|", exchange::Operator::BV_OR },
+    { "^", exchange::Operator::BV_XOR },
+    { "<<", exchange::Operator::BV_SHL },
+    { ">>", exchange::Operator::BV_SHR }
+  };
+
+  if (arity == 1) {
+    auto op = unaryOperators.find(repr);
+    if (op != unaryOperators.end())
+      return op->second;
+  } else if (arity == 2) {
+    if (pointer && repr == "+")
+      return exchange::Operator::PTR_ADD;
+    if (pointer && repr == "-")
+      return exchange::Operator::PTR_SUB;
+    auto op = binaryOperators.find(repr);
+    if (op != binaryOperators.end())
+      return op->second;
+  }
+  return exchange::Operator::UNSUPPORTED;
+}
+
+exchange::Kind resolveKind(const string &kind) {
+  if (kind == "operator")
+    return exchange::Kind::OPERATOR;
+  else if (kind == "dereference")
+    return exchange::Kind::DEREFERENCE;
+  else if (kind == "constant")
+    return exchange::Kind::CONSTANT;
+  else
+    return exchange::Kind::VARIABLE;
 }
 
+/*
+  Serializes schema applications into the binary exchange format (see ExchangeFormat.h) one by one,
+  as they are matched; only the string table and the encoded applications are kept until the end
+ */
+class ExchangeWriter {
+public:
+  void reset() {
+    strings.clear();
+    stringIndexes.clear();
+    body.clear();
+    count = 0;
+  }
+
+  void add(const json::Value &app) {
+    putApplication(body, app);
+    count++;
+  }
+
+  void write(const std::set<uint64_t> &literals, std::ostream &out) {
+    string header;
+    header.append(exchange::MAGIC, sizeof(exchange::MAGIC));
+    put(header, exchange::VERSION);
+    put(header, (uint32_t) strings.size());
+    put(header, (uint32_t) literals.size());
+    put(header, count);
+    for (auto &str : strings) {
+      put(header, (uint32_t) str.size());
+      header.append(str);
+    }
+    for (auto literal : literals) {
+      put(header, (uint64_t) literal);
+    }
+
+    out.write(header.data(), header.size());
+    out.write(body.data(), body.size());
+  }
+
+private:
+  vector<string> strings;
+  std::unordered_map<string, uint32_t> stringIndexes;
+  string body;
+  uint32_t count = 0;
+
+  template<typename T>
+  void put(string &buffer, T value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  uint32_t intern(const string &str) {
+    auto index = stringIndexes.find(str);
+    if (index != stringIndexes.end())
+      return index->second;
+    uint32_t newIndex = strings.size();
+    strings.push_back(str);
+    stringIndexes[str] = newIndex;
+    return newIndex;
+  }
+
+  void putNode(string &buffer, const json::Value &node) {
+    bool pointer = (string(node["type"].GetString()) == "pointer");
+    unsigned arity = node.HasMember("args") ? node["args"].GetArray().Size() : 0;
+    uint8_t flags = 0;
+    if (pointer && node.HasMember("incomplete") && node["incomplete"].GetBool())
+      flags |= exchange::INCOMPLETE_POINTEE;
+
+    exchange::Operator op = exchange::Operator::NONE;
+    if (node.HasMember("args"))
+      op = resolveOperator(node["repr"].GetString(), arity, pointer);
+
+    put(buffer, (uint8_t) resolveKind(node["kind"].GetString()));
+    put(buffer, (uint8_t) (pointer ? exchange::Type::POINTER : exchange::Type::INTEGER));
+    put(buffer, (uint8_t) op);
+    put(buffer, flags);
+    put(buffer, intern(node["rawType"].GetString()));
+    put(buffer, intern(node["repr"].GetString()));
+    put(buffer, (uint32_t) arity);
+    if (arity > 0) {
+      for (auto &arg : node["args"].GetArray()) {
+        putNode(buffer, arg);
+      }
+    }
+  }
+
+  void putApplication(string &buffer, const json::Value &app) {
+    exchange::Schema schema = exchange::Schema::EXPRESSION;
+    string schemaStr = app["schema"].GetString();
+    if (schemaStr == "if_guard")
+      schema = exchange::Schema::IF_GUARD;
+    else if (schemaStr == "initialization")
+      schema = exchange::Schema::INITIALIZATION;
+
+    exchange::Context context = exchange::Context::UNKNOWN;
+    if (string(app["context"].GetString()) == "condition")
+      context = exchange::Context::CONDITION;
+
+    put(buffer, (uint64_t) app["appId"].GetInt64());
+    put(buffer, (uint8_t) schema);
+    put(buffer, (uint8_t) context);
+    put(buffer, (uint32_t) app["location"]["fileId"].GetUint());
+    put(buffer, (uint32_t) app["location"]["beginLine"].GetUint());
+    put(buffer, (uint32_t) app["location"]["beginColumn"].GetUint());
+    put(buffer, (uint32_t) app["location"]["endLine"].GetUint());
+    put(buffer, (uint32_t) app["location"]["endColumn"].GetUint());
+
+    putNode(buffer, app["expression"]);
+
+    std::set<string> completePointeeTypes;
+    put(buffer, (uint32_t) app["components"].GetArray().Size());
+    for (auto &component : app["components"].GetArray()) {
+      putNode(buffer, component);
+      if (string(component["type"].GetString()) == "pointer" && !component["incomplete"].GetBool())
+        completePointeeTypes.insert(component["rawType"].GetString());
+    }
+
+    put(buffer, (uint32_t) completePointeeTypes.size());
+    for (auto &type : completePointeeTypes) {
+      put(buffer, intern(type));
+    }
+  }
+};
+
+}
+
+
+static ExchangeWriter exchangeWriter;
+
+//NOTE: the DOM of all applications is kept only for the JSON debug dump
+static void recordApplication(const json::Value &app) {
+  exchangeWriter.add(app);
+  if (!cfg.jsonFile.empty())
+    schemaApplications.PushBack(json::Value(app, schemaApplications.GetAllocator()),
+                                schemaApplications.GetAllocator());
+}
+
+
 /*
   Clang sometimes (for unknown reasons) starts the same file action or matches the same location twice, which causes crashes or invalid results.
   This is to avoid doing the same twice.
@@ -80,6 +275,8 @@ bool SchemaApplicationAction::BeginSourceFileAction(CompilerInstance &CI, String
   alreadyTransformed = true;
 
   schemaApplications.SetArray();
+  exchangeWriter.reset();
+  literals.clear();
   initInterestingLocations();
   return true;
 }
@@ -94,10 +291,26 @@ void SchemaApplicationAction::EndSourceFileAction() {
       TheRewriter.getEditBuffer(ID).write(llvm::outs());
   }
 
-  std::ofstream ofs(cfg.outputFile);
-  json::OStreamWrapper osw(ofs);
-  json::Writer<json::OStreamWrapper> writer(osw);
-  schemaApplications.Accept(writer);
+  {
+    std::ofstream ofs(cfg.outputFile, std::ios::binary);
+    exchangeWriter.write(literals, ofs);
+  }
+
+  //NOTE: JSON is only a debug dump, literals are repeated in each application to keep it self-contained
+  if (!cfg.jsonFile.empty()) {
+    json::Value literalsJSON(json::kArrayType);
+    for (auto literal : literals) {
+      literalsJSON.PushBack(json::Value().SetUint64(literal), schemaApplications.GetAllocator());
+    }
+    for (auto &app : schemaApplications.GetArray()) {
+      app.AddMember("literals", json::Value(literalsJSON, schemaApplications.GetAllocator()), schemaApplications.GetAllocator());
+    }
+
+    std::ofstream ofs(cfg.jsonFile);
+    json::OStreamWrapper osw(ofs);
+    json::Writer<json::OStreamWrapper> writer(osw);
+    schemaApplications.Accept(writer);
+  }
 }
 
 std::unique_ptr<ASTConsumer> SchemaApplicationAction::CreateASTConsumer(CompilerInstance &CI, StringRef file) {
@@ -109,13 +322,29 @@ std::unique_ptr<ASTConsumer> SchemaApplicationAction::CreateASTConsumer(Compiler
 SchemaApplicationASTConsumer::SchemaApplicationASTConsumer(Rewriter &R) : ExpressionSchemaHandler(R), IfGuardSchemaHandler(R) {
   Matcher.addMatcher(ExpressionSchemaMatcher, &ExpressionSchemaHandler);    
   Matcher.addMatcher(IfGuardSchemaMatcher, &IfGuardSchemaHandler);
+  Matcher.addMatcher(integerLiteral().bind(BOUND), &LiteralHandler);
 }
 
 void SchemaApplicationASTConsumer::HandleTranslationUnit(ASTContext &Context) {
+  buildRepairabilityIndex(Context);
+  initComponentAnalyses(Context);
+  buildScopeIndex(Context);
   Matcher.matchAST(Context);
 }
 
 
+void LiteralCollector::run(const MatchFinder::MatchResult &Result) {
+  if (const IntegerLiteral *literal = Result.Nodes.getNodeAs<clang::IntegerLiteral>(BOUND)) {
+    SourceManager &srcMgr = *Result.SourceManager;
+    std::pair<FileID, unsigned> decLoc = srcMgr.getDecomposedExpansionLoc(literal->getLocStart());
+    if (srcMgr.getMainFileID() != decLoc.first)
+      return;
+    if (literal->getValue().getActiveBits() <= 64)
+      literals.insert(literal->getValue().getZExtValue());
+  }
+}
+
+
 IfGuardSchemaApplicationHandler::IfGuardSchemaApplicationHandler(Rewriter &Rewrite) : Rewrite(Rewrite) {}
 
 void IfGuardSchemaApplicationHandler::run(const MatchFinder::MatchResult &Result) {
@@ -153,26 +382,28 @@ void IfGuardSchemaApplicationHandler::run(const MatchFinder::MatchResult &Result
                  << appId << "\n"
                  << toString(stmt) << "\n";
 
+    //NOTE: the application is serialized when it is matched, so its nodes are freed with the allocator
+    json::Document::AllocatorType allocator;
     json::Value app(json::kObjectType);
-    app.AddMember("schema", json::Value().SetString("if_guard"), schemaApplications.GetAllocator());
+    app.AddMember("schema", json::Value().SetString("if_guard"), allocator);
     json::Value exprJSON(json::kObjectType);
-    exprJSON.AddMember("kind", json::Value().SetString("constant"), schemaApplications.GetAllocator());
-    exprJSON.AddMember("type", json::Value().SetString("integer"), schemaApplications.GetAllocator());
-    exprJSON.AddMember("rawType", json::Value().SetString("int"), schemaApplications.GetAllocator());
-    exprJSON.AddMember("repr", json::Value().SetString("1"), schemaApplications.GetAllocator());
-    app.AddMember("expression", exprJSON, schemaApplications.GetAllocator());
-    app.AddMember("appId", json::Value().SetInt(appId), schemaApplications.GetAllocator());
-    json::Value locJSON = locToJSON(cfg.fileId, beginLine, beginColumn, endLine, endColumn, schemaApplications.GetAllocator());
-    app.AddMember("location", locJSON, schemaApplications.GetAllocator());
-    app.AddMember("context", json::Value().SetString("condition"), schemaApplications.GetAllocator());
+    exprJSON.AddMember("kind", json::Value().SetString("constant"), allocator);
+    exprJSON.AddMember("type", json::Value().SetString("integer"), allocator);
+    exprJSON.AddMember("rawType", json::Value().SetString("int"), allocator);
+    exprJSON.AddMember("repr", json::Value().SetString("1"), allocator);
+    app.AddMember("expression", exprJSON, allocator);
+    app.AddMember("appId", json::Value().SetInt(appId), allocator);
+    json::Value locJSON = locToJSON(cfg.fileId, beginLine, beginColumn, endLine, endColumn, allocator);
+    app.AddMember("location", locJSON, allocator);
+    app.AddMember("context", json::Value().SetString("condition"), allocator);
     json::Value componentsJSON(json::kArrayType);    
-    vector<json::Value> components = collectComponents(stmt, beginLine, Result.Context, schemaApplications.GetAllocator());
+    vector<json::Value> components = collectComponents(stmt, beginLine, Result.Context, allocator);
     string arguments = makeArgumentList(components);
     for (auto &component : components) {
-      componentsJSON.PushBack(component, schemaApplications.GetAllocator());
+      componentsJSON.PushBack(component, allocator);
     }
-    app.AddMember("components", componentsJSON, schemaApplications.GetAllocator());
-    schemaApplications.PushBack(app, schemaApplications.GetAllocator());
+    app.AddMember("components", componentsJSON, allocator);
+    recordApplication(app);
 
 	  unsigned long origLength = Rewrite.getRangeSize(expandedLoc);
     std::ostringstream stringStream;
@@ -182,10 +413,11 @@ void IfGuardSchemaApplicationHandler::run(const MatchFinder::MatchResult &Result
     	stringStream << "{ ";
 
     //FIXME: should I use location or appid for the runtime function name?
+    //NOTE: the last argument is the original value; it is returned in shadow mode
     stringStream << "if ("
-                 << "!(__f1xapp == " << appId << "ul) || "
+                 << "!(__f1xapp == " << appId << "ul || __f1xshadow) || "
                  << "__f1x_" << cfg.fileId << "_" << beginLine << "_" << beginColumn << "_" << endLine << "_" << endColumn
-                 << "(" << arguments << ")"
+                 << "(" << arguments << (arguments.empty() ? "" : ", ") << "1" << ")"
                  << ") "
                  << toString(stmt);
 
@@ -248,34 +480,49 @@ void ExpressionSchemaApplicationHandler::run(const MatchFinder::MatchResult &Res
                  << appId << "\n"
                  << toString(expr) << "\n";
 
+    //NOTE: the application is serialized when it is matched, so its nodes are freed with the allocator
+    json::Document::AllocatorType allocator;
     json::Value app(json::kObjectType);
-    app.AddMember("schema", json::Value().SetString("expression"), schemaApplications.GetAllocator());
-    json::Value exprJSON = stmtToJSON(expr, schemaApplications.GetAllocator());
-    app.AddMember("expression", exprJSON, schemaApplications.GetAllocator());
-    app.AddMember("appId", json::Value().SetInt(appId), schemaApplications.GetAllocator());
-    json::Value locJSON = locToJSON(cfg.fileId, beginLine, beginColumn, endLine, endColumn, schemaApplications.GetAllocator());
-    app.AddMember("location", locJSON, schemaApplications.GetAllocator());
+    app.AddMember("schema", json::Value().SetString("expression"), allocator);
+    json::Value exprJSON = stmtToJSON(expr, allocator);
+    app.AddMember("expression", exprJSON, allocator);
+    app.AddMember("appId", json::Value().SetInt(appId), allocator);
+    json::Value locJSON = locToJSON(cfg.fileId, beginLine, beginColumn, endLine, endColumn, allocator);
+    app.AddMember("location", locJSON, allocator);
     json::Value context;
-    if (inConditionContext(expr, Result.Context)) {
+    bool condition = inConditionContext(expr, Result.Context);
+    if (condition) {
       context = json::Value().SetString("condition");
     } else {
       context = json::Value().SetString("unknown");
     }
-    app.AddMember("context", context, schemaApplications.GetAllocator());
+    app.AddMember("context", context, allocator);
     json::Value componentsJSON(json::kArrayType);
-    vector<json::Value> components = collectComponents(expr, beginLine, Result.Context, schemaApplications.GetAllocator());
+    vector<json::Value> components = collectComponents(expr, beginLine, Result.Context, allocator);
     string arguments = makeArgumentList(components);
     for (auto &component : components) {
-      componentsJSON.PushBack(component, schemaApplications.GetAllocator());
+      componentsJSON.PushBack(component, allocator);
     }
-    app.AddMember("components", componentsJSON, schemaApplications.GetAllocator());
-    schemaApplications.PushBack(app, schemaApplications.GetAllocator());
+    app.AddMember("components", componentsJSON, allocator);
+    recordApplication(app);
     
+    //NOTE: the last argument is the original value (truth value in conditions); it is returned in shadow mode
+    //      and unused when the location is active, so it is evaluated only in shadow mode,
+    //      since the original expression can crash (e.g. division by zero) before a patch takes effect
+    string original = toString(expr);
+    if (condition)
+      original = "!!(" + original + ")";
+
+    std::ostringstream function;
+    function << "__f1x_" << cfg.fileId << "_" << beginLine << "_" << beginColumn << "_" << endLine << "_" << endColumn
+             << "(" << arguments << (arguments.empty() ? "" : ", ");
+
     std::ostringstream stringStream;
-    stringStream << "(__f1xapp == " << appId << "ul ? "
-                 << "__f1x_" << cfg.fileId << "_" << beginLine << "_" << beginColumn << "_" << endLine << "_" << endColumn
-                 << "(" << arguments << ")"
-                 << " : " << toString(expr) << ")";
+    stringStream << "((__f1xapp == " << appId << "ul) ? "
+                 << function.str() << "0)"
+                 << " : (__f1xshadow ? "
+                 << function.str() << original << ")"
+                 << " : " << toString(expr) << "))";
     string replacement = stringStream.str();
 
     Rewrite.ReplaceText(expandedLoc, replacement);
@@ -31,6 +31,12 @@
 using namespace clang;
 using namespace ast_matchers;
 
+class LiteralCollector : public MatchFinder::MatchCallback {
+public:
+  virtual void run(const MatchFinder::MatchResult &Result);
+};
+
+
 class IfGuardSchemaApplicationHandler : public MatchFinder::MatchCallback {
 public:
   IfGuardSchemaApplicationHandler(Rewriter &Rewrite);
@@ -62,6 +68,7 @@ public:
 private:
   ExpressionSchemaApplicationHandler ExpressionSchemaHandler;
   IfGuardSchemaApplicationHandler IfGuardSchemaHandler;
+  LiteralCollector LiteralHandler;
   MatchFinder Matcher;
 };
 
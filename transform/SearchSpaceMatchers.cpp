@@ -16,6 +16,12 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <memory>
+#include <unordered_map>
+
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/ASTMatchers/ASTMatchFinder.h"
+
 #include "SearchSpaceMatchers.h"
 
 using namespace clang;
@@ -74,8 +80,135 @@ StatementMatcher RepairableNode =
         RepairableArraySubscript,
         RepairableAtom);
 
-StatementMatcher NonRepairableNode =
-  unless(RepairableNode);
+namespace {
+
+/*
+  Attributes of statements synthesized bottom-up, so that each node is visited once
+  instead of re-traversing its subtree with hasDescendant for every candidate node:
+  - repairable: the node matches RepairableNode (bound: the match binds the node)
+  - clean: no expression below the node (ignoring parentheses and implicit casts) is non-repairable
+  - schemaBelow: an assignment matching the expression schema or a compound statement is below the node
+ */
+class RepairabilityIndex : public RecursiveASTVisitor<RepairabilityIndex> {
+public:
+  explicit RepairabilityIndex(ASTContext &context): context(context) {
+    TraverseDecl(context.getTranslationUnitDecl());
+  }
+
+  ASTContext &getContext() const { return context; }
+
+  bool VisitStmt(Stmt *stmt) {
+    synthesize(stmt);
+    return true;
+  }
+
+  bool isBaseRepairable(const Stmt *stmt) {
+    const Attributes &node = synthesize(stmt);
+    return node.bound && node.clean;
+  }
+
+  bool isSplittable(const BinaryOperator *op) {
+    if (op->getOpcode() != BO_LOr && op->getOpcode() != BO_LAnd)
+      return false;
+    bool lhs = isRepairableExpression(op->getLHS()->IgnoreParenImpCasts());
+    bool rhs = isRepairableExpression(op->getRHS()->IgnoreParenImpCasts());
+    return lhs != rhs;
+  }
+
+  bool hasSchemaBelow(const Stmt *stmt) {
+    return synthesize(stmt).schemaBelow;
+  }
+
+private:
+  struct Attributes {
+    bool repairable;
+    bool bound;
+    bool clean;
+    bool schemaBelow;
+  };
+
+  ASTContext &context;
+  std::unordered_map<const Stmt*, Attributes> attributes;
+
+  //NOTE: BaseRepairableExpression without the binding requirement
+  bool isRepairableExpression(const Stmt *stmt) {
+    const Attributes &node = synthesize(stmt);
+    return node.repairable && node.clean;
+  }
+
+  bool isRepairableAssignment(const Stmt *stmt) {
+    const BinaryOperator *op = dyn_cast<BinaryOperator>(stmt);
+    if (!op || !op->isAssignmentOp())
+      return false;
+    const Expr *lhs = op->getLHS()->IgnoreParenImpCasts();
+    if (!isa<DeclRefExpr>(lhs) && !isa<MemberExpr>(lhs) && !isa<ArraySubscriptExpr>(lhs))
+      return false;
+    return isRepairableExpression(op->getRHS()->IgnoreParenImpCasts());
+  }
+
+  const Attributes &synthesize(const Stmt *stmt) {
+    auto cached = attributes.find(stmt);
+    if (cached != attributes.end())
+      return cached->second;
+
+    Attributes result = { false, false, true, false };
+    for (const Stmt *child : const_cast<Stmt*>(stmt)->children()) {
+      if (!child)
+        continue;
+      const Attributes &below = synthesize(child);
+      // parentheses and implicit casts are skipped, their operands are checked instead:
+      if (isa<Expr>(child) && !isa<ParenExpr>(child) && !isa<ImplicitCastExpr>(child) && !below.repairable)
+        result.clean = false;
+      if (!below.clean)
+        result.clean = false;
+      if (below.schemaBelow || isa<CompoundStmt>(child) || isRepairableAssignment(child))
+        result.schemaBelow = true;
+    }
+
+    if (isa<Expr>(stmt)) {
+      auto matches = match(RepairableNode, *stmt, context);
+      result.repairable = !matches.empty();
+      result.bound = result.repairable && matches[0].getNodeAs<Stmt>(BOUND) != nullptr;
+    }
+
+    return attributes[stmt] = result;
+  }
+};
+
+std::unique_ptr<RepairabilityIndex> repairabilityIndex;
+
+RepairabilityIndex &getRepairabilityIndex(ASTContext &context) {
+  if (!repairabilityIndex || &repairabilityIndex->getContext() != &context)
+    repairabilityIndex.reset(new RepairabilityIndex(context));
+  return *repairabilityIndex;
+}
+
+}
+
+
+void buildRepairabilityIndex(ASTContext &context) {
+  repairabilityIndex.reset(new RepairabilityIndex(context));
+}
+
+
+namespace clang {
+namespace ast_matchers {
+
+AST_MATCHER(Expr, isBaseRepairable) {
+  return getRepairabilityIndex(Finder->getASTContext()).isBaseRepairable(&Node);
+}
+
+AST_MATCHER(BinaryOperator, isSplittable) {
+  return getRepairabilityIndex(Finder->getASTContext()).isSplittable(&Node);
+}
+
+AST_MATCHER(Stmt, hasNoSchemaBelow) {
+  return !getRepairabilityIndex(Finder->getASTContext()).hasSchemaBelow(&Node);
+}
+
+}
+}
+
 
 /*
   Matches 
@@ -86,19 +219,15 @@ StatementMatcher NonRepairableNode =
   - supported binary and pointer operators
  */
 StatementMatcher BaseRepairableExpression =
-  allOf(RepairableNode,
-        unless(hasDescendant(expr(ignoringParenImpCasts(NonRepairableNode)))));
-
-StatementMatcher NonBaseRepairableExpression =
-  anyOf(unless(RepairableNode),
-        hasDescendant(expr(ignoringParenImpCasts(NonRepairableNode))));
+  expr(isBaseRepairable()).bind(BOUND);
 
+/*
+  Matches || and && one side of which is BaseRepairableExpression and the other is not
+ */
 StatementMatcher Splittable =
-  anyOf(binaryOperator(anyOf(hasOperatorName("||"), hasOperatorName("&&")),
-                       hasLHS(ignoringParenImpCasts(BaseRepairableExpression)),
-                       hasRHS(ignoringParenImpCasts(NonBaseRepairableExpression))),
-        binaryOperator(anyOf(hasOperatorName("||"), hasOperatorName("&&")),
-                       hasLHS(ignoringParenImpCasts(NonBaseRepairableExpression)),
+  anyOf(binaryOperator(isSplittable(),
+                       hasLHS(ignoringParenImpCasts(BaseRepairableExpression))),
+        binaryOperator(isSplittable(),
                        hasRHS(ignoringParenImpCasts(BaseRepairableExpression))));
 
 auto hasSplittableCondition =
@@ -143,9 +272,7 @@ StatementMatcher ExpressionSchemaMatcher =
         RepairableReturn);
 
 StatementMatcher IfGuardSchemaMatcher =
-  anyOf(allOf(unless(hasDescendant(expr(ignoringParenImpCasts(ExpressionSchemaMatcher)))),
-              unless(hasDescendant(stmt(compoundStmt()))), //NOTE: should be stmtExpr, but it is unavailable in Clang 3.8.1
-              callExpr().bind(BOUND)),
+  anyOf(callExpr(hasNoSchemaBelow()).bind(BOUND), //NOTE: compound statements are checked instead of stmtExpr, unavailable in Clang 3.8.1
         breakStmt().bind(BOUND),
         continueStmt().bind(BOUND));
 
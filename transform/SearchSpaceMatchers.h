@@ -23,6 +23,13 @@
 #define BOUND "repairable"
 
 
+/*
+  Precomputes repairability of the AST nodes used by the matchers below in one traversal.
+  NOTE: should be called before matching a new translation unit
+ */
+void buildRepairabilityIndex(clang::ASTContext &context);
+
+
 /*
   Matcher for EXPRESSION transformation schema
  */
@@ -26,6 +26,7 @@ struct Config cfg = {
   /* toLine              = */ 0,
   /* profileFile         = */ "",
   /* outputFile          = */ "",
+  /* jsonFile            = */ "",
   /* beginLine           = */ 0,
   /* beginColumn         = */ 0,
   /* endLine             = */ 0,
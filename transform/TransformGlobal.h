@@ -28,6 +28,7 @@ struct Config {
   unsigned toLine;
   std::string profileFile;
   std::string outputFile;
+  std::string jsonFile;
   unsigned beginLine;
   unsigned beginColumn;
   unsigned endLine;
@@ -17,12 +17,18 @@
 */
 
 #include <algorithm>
+#include <limits>
 #include <map>
 #include <stack>
 #include <sstream>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "clang/Lex/Preprocessor.h"
 #include "clang/AST/Type.h"
+#include "clang/Analysis/AnalysisContext.h"
+#include "clang/Analysis/Analyses/LiveVariables.h"
+#include "clang/Analysis/CFGStmtMap.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "TransformUtil.h"
@@ -108,35 +114,89 @@ void PPConditionalRecoder::Endif(SourceLocation Loc, SourceLocation IfLoc) {
 }
 
 
+namespace {
+
+/*
+  Preprocessor conditionals of the main file as offset intervals, sorted by begin and by end,
+  so that a statement is checked against the conditionals inside its own span only
+ */
+class ConditionalIndex {
+public:
+  ConditionalIndex(): ranges(nullptr), size(0), srcMgr(nullptr) {}
+
+  bool isBuiltFor(const vector<SourceRange> *ranges, const SourceManager *srcMgr) const {
+    return this->ranges == ranges && this->size == ranges->size() && this->srcMgr == srcMgr;
+  }
+
+  void build(const vector<SourceRange> *ranges, SourceManager &srcMgr) {
+    this->ranges = ranges;
+    this->size = ranges->size();
+    this->srcMgr = &srcMgr;
+    byBegin.clear();
+    for (auto range : *ranges) {
+      // only in the main file:
+      std::pair<FileID, unsigned> begin = srcMgr.getDecomposedExpansionLoc(range.getBegin());
+      std::pair<FileID, unsigned> end = srcMgr.getDecomposedExpansionLoc(range.getEnd());
+      if (srcMgr.getMainFileID() != begin.first || srcMgr.getMainFileID() != end.first)
+        continue;
+      byBegin.push_back(std::make_pair(begin.second, end.second));
+    }
+    byEnd = byBegin;
+    std::sort(byBegin.begin(), byBegin.end());
+    std::sort(byEnd.begin(), byEnd.end(), [](const pair<unsigned, unsigned> &a, const pair<unsigned, unsigned> &b) {
+        return a.second < b.second;
+      });
+  }
+
+  /*
+    Matching situation like this (and the opposite):
+    EXPR_BEGIN
+    #ifdef
+    EXPR_END
+    #endif
+  */
+  bool partiallyOverlaps(unsigned begin, unsigned end) const {
+    auto first = std::upper_bound(byBegin.begin(), byBegin.end(), std::make_pair(begin, std::numeric_limits<unsigned>::max()));
+    for (auto it = first; it != byBegin.end() && it->first < end; ++it) {
+      if (end < it->second)
+        return true;
+    }
+    auto last = std::upper_bound(byEnd.begin(), byEnd.end(), begin, [](unsigned offset, const pair<unsigned, unsigned> &range) {
+        return offset < range.second;
+      });
+    for (auto it = last; it != byEnd.end() && it->second < end; ++it) {
+      if (it->first < begin)
+        return true;
+    }
+    return false;
+  }
+
+private:
+  const vector<SourceRange> *ranges;
+  size_t size;
+  const SourceManager *srcMgr;
+  vector<pair<unsigned, unsigned>> byBegin;
+  vector<pair<unsigned, unsigned>> byEnd;
+};
+
+ConditionalIndex conditionalIndex;
+
+}
+
+
 bool intersectConditionalPP(const Stmt* stmt, 
                             SourceManager &srcMgr, 
                             const std::shared_ptr<std::vector<SourceRange>> conditionalsPP) {
-  BeforeThanCompare<SourceLocation> isBefore(srcMgr);
-
-  for (auto range : *conditionalsPP) {
-    // only in the main file:
-    std::pair<FileID, unsigned> decLoc = srcMgr.getDecomposedExpansionLoc(range.getBegin());
-    if (srcMgr.getMainFileID() != decLoc.first)
-      continue;
-
-    /*
-      Matching situation like this (and the opposite):
-      EXPR_BEGIN
-      #ifdef
-      EXPR_END
-      #endif
-     */
-    if ((isBefore(stmt->getLocStart(), range.getBegin()) &&
-         isBefore(range.getBegin(), stmt->getLocEnd()) &&
-         isBefore(stmt->getLocEnd(), range.getEnd())) || 
-        (isBefore(range.getBegin(), stmt->getLocStart()) && 
-         isBefore(stmt->getLocStart(), range.getEnd()) && 
-         isBefore(range.getEnd(), stmt->getLocEnd()))) {
-      return true;
-    }
-  }
+  //NOTE: conditionals are recorded during preprocessing, so the index is rebuilt only when they change
+  if (!conditionalIndex.isBuiltFor(conditionalsPP.get(), &srcMgr))
+    conditionalIndex.build(conditionalsPP.get(), srcMgr);
 
-  return false;
+  std::pair<FileID, unsigned> begin = srcMgr.getDecomposedExpansionLoc(stmt->getLocStart());
+  std::pair<FileID, unsigned> end = srcMgr.getDecomposedExpansionLoc(stmt->getLocEnd());
+  if (srcMgr.getMainFileID() != begin.first || srcMgr.getMainFileID() != end.first)
+    return false;
+
+  return conditionalIndex.partiallyOverlaps(begin.second, end.second);
 }
 
 
@@ -349,6 +409,31 @@ string clangKindToString(const BuiltinType::Kind kind) {
   }
 }
 
+/*
+  Condition that holds iff every pointer dereferenced by a member expression is not NULL,
+  e.g. "((a) && (a->b))" for "a->b->c"; empty if nothing is dereferenced
+*/
+string dereferenceGuard(const MemberExpr *Node) {
+  vector<string> bases;
+  const Expr *current = Node;
+  while (const MemberExpr *member = dyn_cast<MemberExpr>(current)) {
+    if (member->isArrow())
+      bases.push_back(toString(member->getBase()));
+    current = member->getBase()->IgnoreParenImpCasts();
+  }
+  if (bases.size() == 1)
+    return bases[0];
+  //NOTE: innermost pointers are checked first
+  std::reverse(bases.begin(), bases.end());
+  string guard;
+  for (auto &base : bases) {
+    if (! guard.empty())
+      guard += " && ";
+    guard += "(" + base + ")";
+  }
+  return guard.empty() ? guard : "(" + guard + ")";
+}
+
 class StmtToJSON : public StmtVisitor<StmtToJSON> {
   json::Document::AllocatorType *allocator;
   PrintingPolicy policy;
@@ -464,7 +549,9 @@ public:
   void VisitMemberExpr(MemberExpr *Node) {
     json::Value node(json::kObjectType);
 
-    if (Node->isArrow()) {
+    //NOTE: "a->b.c" also dereferences "a"
+    string guard = dereferenceGuard(Node);
+    if (! guard.empty()) {
       node.AddMember("kind", json::Value().SetString("dereference"), *allocator);
     } else {
       node.AddMember("kind", json::Value().SetString("variable"), *allocator);
@@ -482,10 +569,10 @@ public:
     json::Value repr;
     repr.SetString(toString(Node).c_str(), *allocator);
     node.AddMember("repr", repr, *allocator);
-    if (Node->isArrow()) {
-      json::Value baseRepr;
-      baseRepr.SetString(toString(Node->getBase()).c_str(), *allocator);
-      node.AddMember("base", baseRepr, *allocator);
+    if (! guard.empty()) {
+      json::Value guardRepr;
+      guardRepr.SetString(guard.c_str(), *allocator);
+      node.AddMember("guard", guardRepr, *allocator);
     }
 
     path.push(std::move(node));
@@ -595,18 +682,124 @@ bool isSuitableComponentType(const QualType &type) {
 }
 
 
+const FunctionDecl *enclosingFunction(const Stmt *stmt, ASTContext *context) {
+  ast_type_traits::DynTypedNode node = ast_type_traits::DynTypedNode::create(*stmt);
+  while (true) {
+    const FunctionDecl *fd;
+    if ((fd = node.get<FunctionDecl>()) != NULL)
+      return fd;
+    auto parents = context->getParents(node);
+    if (parents.size() == 0)
+      return NULL;
+    node = *(parents.begin()); // FIXME: for now only first
+  }
+}
+
+
+// NOTE: the CFG and the analyses of each function are built once per translation unit and cached by the manager
+static std::unique_ptr<AnalysisDeclContextManager> analysisManager;
+static const ASTContext *analysisContext = NULL;
+
+void initComponentAnalyses(ASTContext &context) {
+  analysisManager.reset(new AnalysisDeclContextManager());
+  analysisManager->getCFGBuildOptions().setAllAlwaysAdd();
+  analysisContext = &context;
+}
+
+AnalysisDeclContextManager &getAnalysisManager(ASTContext *context) {
+  if (!analysisManager || analysisContext != context)
+    initComponentAnalyses(*context);
+  return *analysisManager;
+}
+
+
+/*
+  Liveness of local variables at a location based on Clang's LiveVariables analysis.
+  A variable is live at the location if it is live at the end of the CFG block of the location
+  or used in this block. Non-local variables and variables of unsupported functions are live.
+ */
+class LocationLiveness {
+private:
+  LiveVariables *liveVariables;
+  const CFGBlock *block;
+  std::unordered_set<const VarDecl*> usedInBlock;
+
+public:
+  LocationLiveness(const Stmt *stmt, ASTContext *context):
+    liveVariables(NULL),
+    block(NULL) {
+    const FunctionDecl *fd = enclosingFunction(stmt, context);
+    if (fd == NULL || !fd->hasBody())
+      return;
+    AnalysisDeclContext *adc = getAnalysisManager(context).getContext(fd);
+    CFGStmtMap *stmtMap = adc->getCFGStmtMap();
+    if (stmtMap == NULL)
+      return;
+    block = stmtMap->getBlock(const_cast<Stmt*>(stmt));
+    if (block == NULL)
+      return;
+    liveVariables = adc->getAnalysis<LiveVariables>();
+    for (auto &element : *block) {
+      if (Optional<CFGStmt> cfgStmt = element.getAs<CFGStmt>()) {
+        if (const DeclRefExpr *ref = dyn_cast<DeclRefExpr>(cfgStmt->getStmt())) {
+          if (const VarDecl *vd = dyn_cast<VarDecl>(ref->getDecl()))
+            usedInBlock.insert(vd->getCanonicalDecl());
+        }
+      }
+    }
+  }
+
+  bool isLive(const VarDecl *vd) const {
+    if (liveVariables == NULL || !vd->hasLocalStorage())
+      return true;
+    return usedInBlock.count(vd->getCanonicalDecl()) || liveVariables->isLive(block, vd);
+  }
+};
+
+
+// variable that is accessed through member access, subscript or dereference
+const VarDecl *baseVariable(const Expr *expr) {
+  while (true) {
+    expr = expr->IgnoreParenImpCasts();
+    if (const MemberExpr *member = dyn_cast<MemberExpr>(expr)) {
+      expr = member->getBase();
+    } else if (const ArraySubscriptExpr *subscript = dyn_cast<ArraySubscriptExpr>(expr)) {
+      expr = subscript->getBase();
+    } else if (const UnaryOperator *unary = dyn_cast<UnaryOperator>(expr)) {
+      expr = unary->getSubExpr();
+    } else if (const DeclRefExpr *ref = dyn_cast<DeclRefExpr>(expr)) {
+      return dyn_cast<VarDecl>(ref->getDecl());
+    } else {
+      return NULL;
+    }
+  }
+}
+
+
 class CollectComponents : public StmtVisitor<CollectComponents> {
 private:
   json::Document::AllocatorType *allocator;
   bool ignoreCasts;
   bool suitableTypes;
+  const LocationLiveness *liveness;
   vector<json::Value> collected;
 
+  bool isDead(const Expr *expr) {
+    if (liveness == NULL)
+      return false;
+    const VarDecl *vd = baseVariable(expr);
+    return vd != NULL && !liveness->isLive(vd);
+  }
+
 public:
-  CollectComponents(json::Document::AllocatorType *allocator, bool ignoreCasts, bool suitableTypes):
+  CollectComponents(json::Document::AllocatorType *allocator,
+                    bool ignoreCasts,
+                    bool suitableTypes,
+                    const LocationLiveness *liveness):
     allocator(allocator),
     ignoreCasts(ignoreCasts),
-    suitableTypes(suitableTypes) {}
+    suitableTypes(suitableTypes),
+    liveness(liveness) {}
 
   vector<json::Value> getCollected() {
     return std::move(collected);
@@ -643,17 +836,17 @@ public:
   void VisitCharacterLiteral(CharacterLiteral *Node) {}
 
   void VisitMemberExpr(MemberExpr *Node) {
-    if (!suitableTypes || isSuitableComponentType(Node->getType()))
+    if ((!suitableTypes || isSuitableComponentType(Node->getType())) && !isDead(Node))
       collected.push_back(stmtToJSON(Node, *allocator));
   }
 
   void VisitDeclRefExpr(DeclRefExpr *Node) {
-    if (!suitableTypes || isSuitableComponentType(Node->getType()))
+    if ((!suitableTypes || isSuitableComponentType(Node->getType())) && !isDead(Node))
       collected.push_back(stmtToJSON(Node, *allocator));
   }
 
   void VisitArraySubscriptExpr(ArraySubscriptExpr *Node) {
-    if (!suitableTypes || isSuitableComponentType(Node->getType()))
+    if ((!suitableTypes || isSuitableComponentType(Node->getType())) && !isDead(Node))
       collected.push_back(stmtToJSON(Node, *allocator));
   }
 
@@ -663,8 +856,9 @@ public:
 vector<json::Value> collectFromExpression(const Stmt *stmt,
                                           json::Document::AllocatorType &allocator,
                                           bool ignoreCasts,
-                                          bool suitableTypes) {
-  CollectComponents T(&allocator, ignoreCasts, suitableTypes);
+                                          bool suitableTypes,
+                                          const LocationLiveness *liveness = NULL) {
+  CollectComponents T(&allocator, ignoreCasts, suitableTypes, liveness);
   T.Visit(const_cast<Stmt*>(stmt));
   return T.getCollected();
 }
@@ -691,123 +885,216 @@ json::Value varDeclToJSON(VarDecl *vd, json::Document::AllocatorType &allocator)
 }
 
 
-vector<json::Value> collectVisible(const ast_type_traits::DynTypedNode &node,
-                                   unsigned line,
-                                   ASTContext* context,
-                                   json::Document::AllocatorType &allocator) {
-  vector<json::Value> result;
+/*
+  Index of the statements of compound statements and of global variables sorted by their
+  expanded begin lines. It is built on demand once per compound statement (and once per
+  translation unit for globals), so that the components visible at a location are found by
+  binary search instead of scanning enclosing blocks for every location.
+  NOTE: an index is valid only for the translation unit of its context
+ */
+class ScopeIndex {
+public:
+  ScopeIndex(const ASTContext &context): context(context) {}
+
+  const ASTContext &getContext() const {
+    return context;
+  }
 
-  const FunctionDecl* fd;
-  if ((fd = node.get<FunctionDecl>()) != NULL) {
+  struct Entry {
+    unsigned line;
+    const Stmt *stmt;
+  };
+
+  const vector<Entry> &statements(const CompoundStmt *cstmt, SourceManager &srcMgr) {
+    auto cached = compounds.find(cstmt);
+    if (cached != compounds.end())
+      return cached->second;
+    vector<Entry> &result = compounds[cstmt];
+    for (auto it = cstmt->body_begin(); it != cstmt->body_end(); ++it) {
+      SourceRange expandedLoc = getExpandedLoc(*it, srcMgr);
+      result.push_back(Entry{srcMgr.getExpansionLineNumber(expandedLoc.getBegin()), *it});
+    }
+    std::stable_sort(result.begin(), result.end(), [](const Entry &a, const Entry &b) {
+        return a.line < b.line;
+      });
+    return result;
+  }
 
-    // adding function parameters
-    for (auto it = fd->param_begin(); it != fd->param_end(); ++it) {
-      auto vd = cast<VarDecl>(*it);
-      if (isSuitableComponentType(vd->getType())) {
-        result.push_back(varDeclToJSON(vd, allocator));
+  const vector<pair<unsigned, const VarDecl*>> &globals(const TranslationUnitDecl *tu, SourceManager &srcMgr) {
+    if (!globalsIndexed) {
+      for (auto it = tu->decls_begin(); it != tu->decls_end(); ++it) {
+        if (isa<VarDecl>(*it)) {
+          VarDecl* vd = cast<VarDecl>(*it);
+          globalVariables.push_back(std::make_pair(getDeclExpandedLine(vd, srcMgr), vd));
+        }
       }
+      std::stable_sort(globalVariables.begin(), globalVariables.end(),
+                       [](const pair<unsigned, const VarDecl*> &a, const pair<unsigned, const VarDecl*> &b) {
+                         return a.first < b.first;
+                       });
+      globalsIndexed = true;
     }
+    return globalVariables;
+  }
 
-    if (cfg.useGlobalVariables) {
-      auto parents = context->getParents(node);
-      if (parents.size() > 0) {
-        const ast_type_traits::DynTypedNode parent = *(parents.begin()); // FIXME: for now only first
-        const TranslationUnitDecl* tu;
-        if ((tu = parent.get<TranslationUnitDecl>()) != NULL) {
-          for (auto it = tu->decls_begin(); it != tu->decls_end(); ++it) {
-            if (isa<VarDecl>(*it)) {
-              VarDecl* vd = cast<VarDecl>(*it);
-              unsigned beginLine = getDeclExpandedLine(vd, context->getSourceManager());
-              if (line > beginLine && isSuitableComponentType(vd->getType())) {
-                result.push_back(varDeclToJSON(vd, allocator));
-              }
-            }
-          }
+private:
+  const ASTContext &context;
+  std::unordered_map<const CompoundStmt*, vector<Entry>> compounds;
+  vector<pair<unsigned, const VarDecl*>> globalVariables;
+  bool globalsIndexed = false;
+};
+
+static std::unique_ptr<ScopeIndex> scopeIndex;
+
+void buildScopeIndex(ASTContext &context) {
+  scopeIndex.reset(new ScopeIndex(context));
+}
+
+static ScopeIndex &getScopeIndex(ASTContext *context) {
+  if (!scopeIndex || &scopeIndex->getContext() != context)
+    buildScopeIndex(*context);
+  return *scopeIndex;
+}
+
+
+// components are de-duplicated by their representation
+class VisibleComponents {
+public:
+  VisibleComponents(json::Document::AllocatorType &allocator): allocator(allocator) {}
+
+  void add(json::Value &&component) {
+    string repr = component["repr"].GetString();
+    if (reprs.insert(repr).second)
+      components.push_back(std::move(component));
+  }
+
+  void add(const VarDecl *vd) {
+    if (!reprs.count(vd->getName().str()))
+      add(varDeclToJSON(const_cast<VarDecl*>(vd), allocator));
+  }
+
+  vector<json::Value> take() {
+    return std::move(components);
+  }
+
+private:
+  json::Document::AllocatorType &allocator;
+  std::unordered_set<string> reprs;
+  vector<json::Value> components;
+};
+
+
+// components introduced by a statement that precedes the location in an enclosing block
+void collectIntroduced(const Stmt *stmt,
+                       json::Document::AllocatorType &allocator,
+                       const LocationLiveness &liveness,
+                       VisibleComponents &visible) {
+  if (isa<BinaryOperator>(stmt)) {
+    const BinaryOperator* op = cast<BinaryOperator>(stmt);
+    // FIXME: support declarations with initialization
+    // FIXME: support augmented assignments:
+    // FIXME: is it redundant if we use collect funnction on whole statement
+    if (BinaryOperator::getOpcodeStr(op->getOpcode()).lower() == "=" &&
+        isa<DeclRefExpr>(op->getLHS())) {
+      const DeclRefExpr* dref = cast<DeclRefExpr>(op->getLHS());
+      const VarDecl* vd;
+      if ((vd = dyn_cast<VarDecl>(dref->getDecl())) != NULL && isSuitableComponentType(vd->getType()) && liveness.isLive(vd)) {
+        visible.add(vd);
+      }
+    }
+  }
+
+  if (isa<DeclStmt>(stmt)) {
+    const DeclStmt* dstmt = cast<DeclStmt>(stmt);
+    for (auto it = dstmt->decl_begin(); it != dstmt->decl_end(); ++it) {
+      const Decl* d = *it;
+      if (isa<VarDecl>(d)) {
+        const VarDecl* vd = cast<VarDecl>(d);
+        // NOTE: hasInit because don't want to use garbage
+        if (vd->hasInit() && isSuitableComponentType(vd->getType()) && liveness.isLive(vd)) {
+          visible.add(vd);
         }
       }
     }
-    
-  } else {
+  }
 
-    const CompoundStmt* cstmt;
-    if ((cstmt = node.get<CompoundStmt>()) != NULL) {
-      for (auto it = cstmt->body_begin(); it != cstmt->body_end(); ++it) {
-
-        if (isa<BinaryOperator>(*it)) {
-          BinaryOperator* op = cast<BinaryOperator>(*it);
-          SourceRange expandedLoc = getExpandedLoc(op, context->getSourceManager());
-          unsigned beginLine = context->getSourceManager().getExpansionLineNumber(expandedLoc.getBegin());
-          // FIXME: support declarations with initialization
-          // FIXME: support augmented assignments:
-          // FIXME: is it redundant if we use collect funnction on whole statement
-          if (line > beginLine &&
-              BinaryOperator::getOpcodeStr(op->getOpcode()).lower() == "=" &&
-              isa<DeclRefExpr>(op->getLHS())) {
-            DeclRefExpr* dref = cast<DeclRefExpr>(op->getLHS());
-            VarDecl* vd;
-            if ((vd = cast<VarDecl>(dref->getDecl())) != NULL && isSuitableComponentType(vd->getType())) {
-              result.push_back(varDeclToJSON(vd, allocator));
-            }
-          }
+  for (auto &c : collectFromExpression(stmt, allocator, true, true, &liveness)) {
+    visible.add(std::move(c));
+  }
+
+  // FIXME: is it redundant?
+  // TODO: should be generalized for other cases:
+  if (isa<IfStmt>(stmt)) {
+    const IfStmt* ifStmt = cast<IfStmt>(stmt);
+    const Stmt* thenStmt = ifStmt->getThen();
+    if (isa<CallExpr>(*thenStmt)) {
+      const CallExpr* callExpr = cast<CallExpr>(thenStmt);
+      for (auto a = callExpr->arg_begin(); a != callExpr->arg_end(); ++a) {
+        auto e = cast<Expr>(*a);
+        for (auto &c : collectFromExpression(e, allocator, true, true, &liveness)) {
+          visible.add(std::move(c));
         }
+      }
+    }
+  }
+}
 
-        if (isa<DeclStmt>(*it)) {
-          DeclStmt* dstmt = cast<DeclStmt>(*it);
-          SourceRange expandedLoc = getExpandedLoc(dstmt, context->getSourceManager());
-          unsigned beginLine = context->getSourceManager().getExpansionLineNumber(expandedLoc.getBegin());
-          for (auto it = dstmt->decl_begin(); it != dstmt->decl_end(); ++it) {
-            Decl* d = *it;
-            if (isa<VarDecl>(d)) {
-              VarDecl* vd = cast<VarDecl>(d);
-              // NOTE: hasInit because don't want to use garbage
-              if (line > beginLine && vd->hasInit() && isSuitableComponentType(vd->getType())) {
-                result.push_back(varDeclToJSON(vd, allocator));
-              }
-            }
-          }
+
+void collectVisible(const ast_type_traits::DynTypedNode &location,
+                    unsigned line,
+                    ASTContext* context,
+                    json::Document::AllocatorType &allocator,
+                    const LocationLiveness &liveness,
+                    VisibleComponents &visible) {
+  SourceManager &srcMgr = context->getSourceManager();
+  ast_type_traits::DynTypedNode node = location;
+  while (true) {
+    const FunctionDecl* fd;
+    if ((fd = node.get<FunctionDecl>()) != NULL) {
+
+      // adding function parameters
+      for (auto it = fd->param_begin(); it != fd->param_end(); ++it) {
+        auto vd = cast<VarDecl>(*it);
+        if (isSuitableComponentType(vd->getType()) && liveness.isLive(vd)) {
+          visible.add(vd);
         }
+      }
 
-        Stmt* stmt = cast<Stmt>(*it);
-        SourceRange expandedLoc = getExpandedLoc(stmt, context->getSourceManager());
-        unsigned beginLine = context->getSourceManager().getExpansionLineNumber(expandedLoc.getBegin());
-        if (line > beginLine) {
-          vector<json::Value> fromExpr = collectFromExpression(*it, allocator, true, true);
-          for (auto &c : fromExpr) {
-            result.push_back(std::move(c));
-          }
-          
-          // FIXME: is it redundant?
-          // TODO: should be generalized for other cases:
-          if (isa<IfStmt>(*it)) {
-            IfStmt* ifStmt = cast<IfStmt>(*it);
-            Stmt* thenStmt = ifStmt->getThen();
-            if (isa<CallExpr>(*thenStmt)) {
-              CallExpr* callExpr = cast<CallExpr>(thenStmt);
-              for (auto a = callExpr->arg_begin(); a != callExpr->arg_end(); ++a) {
-                auto e = cast<Expr>(*a);
-                vector<json::Value> fromParamExpr = collectFromExpression(e, allocator, true, true);
-                for (auto &c : fromParamExpr) {
-                  result.push_back(std::move(c));
-                }
+      if (cfg.useGlobalVariables) {
+        auto parents = context->getParents(node);
+        if (parents.size() > 0) {
+          const ast_type_traits::DynTypedNode parent = *(parents.begin()); // FIXME: for now only first
+          const TranslationUnitDecl* tu;
+          if ((tu = parent.get<TranslationUnitDecl>()) != NULL) {
+            auto &globals = getScopeIndex(context).globals(tu, srcMgr);
+            for (auto it = globals.begin(); it != globals.end() && it->first < line; ++it) {
+              if (isSuitableComponentType(it->second->getType())) {
+                visible.add(it->second);
               }
             }
           }
         }
-        
       }
+      return;
     }
-    
-    auto parents = context->getParents(node);
-    if (parents.size() > 0) {
-      const ast_type_traits::DynTypedNode parent = *(parents.begin()); // TODO: for now only first
-      vector<json::Value> parentResult = collectVisible(parent, line, context, allocator);
-      for (auto &c : parentResult) {
-        result.push_back(std::move(c));
+
+    const CompoundStmt* cstmt;
+    if ((cstmt = node.get<CompoundStmt>()) != NULL) {
+      auto &statements = getScopeIndex(context).statements(cstmt, srcMgr);
+      auto end = std::lower_bound(statements.begin(), statements.end(), line,
+                                  [](const ScopeIndex::Entry &entry, unsigned line) {
+                                    return entry.line < line;
+                                  });
+      for (auto it = statements.begin(); it != end; ++it) {
+        collectIntroduced(it->stmt, allocator, liveness, visible);
       }
     }
+
+    auto parents = context->getParents(node);
+    if (parents.size() == 0)
+      return;
+    node = *(parents.begin()); // TODO: for now only first
   }
-  
-  return result;
 }
 
 
@@ -815,34 +1102,18 @@ vector<json::Value> collectComponents(const Stmt *stmt,
                                       unsigned line,
                                       ASTContext *context,
                                       json::Document::AllocatorType &allocator) {
-  vector<json::Value> fromExpr = collectFromExpression(stmt, allocator, false, false);
-
-  const ast_type_traits::DynTypedNode node = ast_type_traits::DynTypedNode::create(*stmt);
-  vector<json::Value> visible = collectVisible(node, line, context, allocator);
+  VisibleComponents result(allocator);
 
-  vector<json::Value> result;
+  for (auto &c : collectFromExpression(stmt, allocator, false, false)) {
+    result.add(std::move(c));
+  }
 
-  for (auto &c : fromExpr) {
-    bool newComponent = true;
-    for (auto &old : result) {
-      if (c["repr"] == old["repr"])
-        newComponent = false;
-    }
-    if (newComponent)
-      result.push_back(std::move(c));
-  }  
-
-  for (auto &c : visible) {
-    bool newComponent = true;
-    for (auto &old : result) {
-      if (c["repr"] == old["repr"])
-        newComponent = false;
-    }
-    if (newComponent)
-      result.push_back(std::move(c));
-  }  
+  const ast_type_traits::DynTypedNode node = ast_type_traits::DynTypedNode::create(*stmt);
+  //NOTE: only variables that are live at the location are used as components
+  LocationLiveness liveness(stmt, context);
+  collectVisible(node, line, context, allocator, liveness, result);
 
-  return result;
+  return result.take();
 }
 
 
@@ -858,15 +1129,14 @@ string makeArgumentList(vector<json::Value> &components) {
   vector<string> completePointeeTypes;
   vector<string> nonPointerTypes;
   vector<string> dereferences;
-  map<string, string> baseOfDereference;
+  map<string, string> guardOfDereference;
   for (auto &c : components) {
     string kind = c["kind"].GetString();
     if (kind == "dereference") {
       string repr = c["repr"].GetString();
       if (std::find(dereferences.begin(), dereferences.end(), repr) == dereferences.end()) {
         dereferences.push_back(repr);
-        string base = c["base"].GetString();
-        baseOfDereference[repr] = base;
+        guardOfDereference[repr] = c["guard"].GetString();
       }
     }
     string type = c["type"].GetString();
@@ -911,8 +1181,8 @@ string makeArgumentList(vector<json::Value> &components) {
         result << ", ";
       }
       string repr = (*c)["repr"].GetString();
-      if (baseOfDereference.count(repr)) {
-        result << "(!" << baseOfDereference[repr]
+      if (guardOfDereference.count(repr)) {
+        result << "(!" << guardOfDereference[repr]
                << " ? 0 : " << repr << ")";
       } else {
         result << repr;
@@ -935,8 +1205,8 @@ string makeArgumentList(vector<json::Value> &components) {
         result << ", ";
       }
       string repr = (*c)["repr"].GetString();
-      if (baseOfDereference.count(repr)) {
-        result << "(!" << baseOfDereference[repr]
+      if (guardOfDereference.count(repr)) {
+        result << "(!" << guardOfDereference[repr]
                << " ? (void*)0 : " << repr << ")";
       } else {
         result << repr;
@@ -970,10 +1240,68 @@ string makeArgumentList(vector<json::Value> &components) {
       } else {
         result << ", ";
       }
-      result << "!" << baseOfDereference[d];
+      result << "!" << guardOfDereference[d];
     }
     result << "}";
   }
 
   return result.str();
 }
+
+
+/*
+  Structure:
+  "number of components, component values, validity flags"
+  NOTE: values are recorded in the order of components, which is the order used by the runtime;
+  subscripts not evaluated by the expression itself are not recorded, since they can be out of bounds;
+  the arrays are local variables defined by the declarations
+*/
+string makeValueList(const Stmt *expr,
+                     vector<json::Value> &components,
+                     json::Document::AllocatorType &allocator,
+                     string &declarations) {
+  vector<string> evaluated;
+  if (expr) {
+    for (auto &c : collectFromExpression(expr, allocator, false, false)) {
+      evaluated.push_back(c["repr"].GetString());
+    }
+  }
+
+  if (components.empty()) {
+    declarations = "";
+    return "0, (long long*)0, (char*)0";
+  }
+
+  std::ostringstream values;
+  std::ostringstream validity;
+  bool first = true;
+  for (auto &c : components) {
+    if (first) {
+      first = false;
+    } else {
+      values << ", ";
+      validity << ", ";
+    }
+    string repr = c["repr"].GetString();
+    string kind = c["kind"].GetString();
+    bool subscript = repr.find('[') != string::npos;
+    if (subscript && std::find(evaluated.begin(), evaluated.end(), repr) == evaluated.end()) {
+      values << "0";
+      validity << "0";
+    } else if (kind == "dereference") {
+      string guard = c["guard"].GetString();
+      values << "(!" << guard << " ? 0 : (long long) (" << repr << "))";
+      validity << "(!" << guard << " ? 0 : 1)";
+    } else {
+      values << "(long long) (" << repr << ")";
+      validity << "1";
+    }
+  }
+
+  declarations = "long long __f1x_value_list[] = {" + values.str() + "}; " +
+                 "char __f1x_validity_list[] = {" + validity.str() + "}; ";
+
+  std::ostringstream result;
+  result << components.size() << ", __f1x_value_list, __f1x_validity_list";
+  return result.str();
+}
@@ -114,6 +114,18 @@ rapidjson::Value locToJSON(unsigned fileId, unsigned bl, unsigned bc, unsigned e
                            rapidjson::Document::AllocatorType &allocator);
 
 
+/*
+  Discards the analyses used for collecting components, which are cached per translation unit.
+  NOTE: should be called before matching a new translation unit
+ */
+void initComponentAnalyses(clang::ASTContext &context);
+
+/*
+  Discards the index of scopes used for collecting visible components.
+  NOTE: should be called before matching a new translation unit
+ */
+void buildScopeIndex(clang::ASTContext &context);
+
 std::vector<rapidjson::Value> collectComponents(const clang::Stmt *stmt,
                                                 unsigned line,
                                                 clang::ASTContext *context,
@@ -122,5 +134,10 @@ std::vector<rapidjson::Value> collectComponents(const clang::Stmt *stmt,
 
 std::string makeArgumentList(std::vector<rapidjson::Value> &components);
 
+std::string makeValueList(const clang::Stmt *expr,
+                          std::vector<rapidjson::Value> &components,
+                          rapidjson::Document::AllocatorType &allocator,
+                          std::string &declarations);
+
 unsigned long f1xapp(unsigned long baseId, unsigned fileId);
 bool inRange(unsigned line);